@@ -13,6 +13,8 @@ const std::string Cp3mm::AppInfo::StdMdlFilesExt   = ".mpp";
 const std::string Cp3mm::AppInfo::CHeaderFilesExt  = ".h";
 const std::string Cp3mm::AppInfo::CppFilesExt      = ".cpp";
 const std::string Cp3mm::AppInfo::DepFilesExt      = ".dep";
+const std::string Cp3mm::AppInfo::MakeDepFilesExt  = ".d";
+const std::string Cp3mm::AppInfo::SymFilesExt      = ".sym";
 const std::string * Cp3mm::AppInfo::AcceptedExts[] = { &Cp3FilesExt, &StdMdlFilesExt, NULL };
 
 bool Cp3mm::AppInfo::isAcceptedExt(const std::string &x)
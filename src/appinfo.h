@@ -40,6 +40,12 @@ public:
     /// File extension for dependency files
     static const std::string DepFilesExt;
 
+    /// File extension for Makefile-syntax dependency files
+    static const std::string MakeDepFilesExt;
+
+    /// File extension for the symbols exported and used by modules
+    static const std::string SymFilesExt;
+
     /// Vector of string pointers for accepted file extensions
     static const std::string * AcceptedExts[];
 
@@ -0,0 +1,279 @@
+// cp3build.cpp
+/*
+    Implementation of the generation of build files
+*/
+
+#include "cp3build.h"
+#include "cp3parser.h"
+#include "appinfo.h"
+#include "fileman.h"
+
+namespace Cp3mm {
+
+const std::string BuildFileGenerator::NinjaFileName = "build.ninja";
+const std::string BuildFileGenerator::MakeFileName  = "cp3.mk";
+
+static std::string escapeForNinja(const std::string &fileName)
+{
+    std::string toret;
+
+    for(unsigned int i = 0; i < fileName.length(); ++i) {
+        const char ch = fileName[ i ];
+
+        if ( ch == '$'
+          || ch == ' '
+          || ch == ':' )
+        {
+            toret += '$';
+        }
+
+        toret += ch;
+    }
+
+    return toret;
+}
+
+BuildFileGenerator::BuildFileGenerator(const std::vector<std::string> &moduleFileNames)
+{
+    for(unsigned int i = 0; i < moduleFileNames.size(); ++i) {
+        if ( AppInfo::isAcceptedExt( FileMan::getExt( moduleFileNames[ i ] ) ) ) {
+            scanners.push_back( Parser::ModuleScanner( moduleFileNames[ i ] ) );
+        }
+    }
+
+    scan();
+}
+
+void BuildFileGenerator::scan()
+{
+    Parser::ModuleScanner::scanAll( scanners );
+
+    // Find all modules and their headers
+    for(unsigned int i = 0; i < scanners.size(); ++i) {
+        const std::string &module = scanners[ i ].getFileName();
+
+        modulesByHeader[ FileMan::replaceExt( module, AppInfo::CHeaderFilesExt ) ] = module;
+    }
+
+    // Find the modules imported by each module
+    for(unsigned int i = 0; i < scanners.size(); ++i) {
+        const std::string &module = scanners[ i ].getFileName();
+        const Parser::ModuleScanner::Headers headers = scanners[ i ].getDependencies();
+        ModuleSet &moduleImports = imports[ module ];
+
+        for(unsigned int j = 0; j < headers.size(); ++j) {
+            std::map<std::string, std::string>::const_iterator it = modulesByHeader.find( headers[ j ] );
+
+            if ( it != modulesByHeader.end()
+              && it->second != module )
+            {
+                moduleImports.insert( it->second );
+            }
+        }
+    }
+}
+
+void BuildFileGenerator::collectImports(const std::string &module, ModuleSet &closure) const
+{
+    std::map<std::string, ModuleSet>::const_iterator it = imports.find( module );
+
+    if ( it != imports.end() ) {
+        for(ModuleSet::const_iterator itImp = it->second.begin(); itImp != it->second.end(); ++itImp)
+        {
+            if ( closure.insert( *itImp ).second ) {
+                collectImports( *itImp, closure );
+            }
+        }
+    }
+}
+
+std::string BuildFileGenerator::getObjectName(const std::string &module)
+{
+    return FileMan::replaceExt( module, ".o" );
+}
+
+std::string BuildFileGenerator::getExecutableName(const std::string &module)
+{
+    std::string toret = module;
+    std::string::size_type pos = toret.rfind( '.' );
+
+    if ( pos != std::string::npos ) {
+        toret.erase( pos );
+    }
+
+    return toret;
+}
+
+std::string BuildFileGenerator::join(const ModuleSet &modules, const std::string &ext)
+{
+    std::string toret;
+
+    for(ModuleSet::const_iterator it = modules.begin(); it != modules.end(); ++it) {
+        toret += ' ';
+        toret += Parser::Cp3Parser::escapeForMake( FileMan::replaceExt( *it, ext ) );
+    }
+
+    return toret;
+}
+
+std::string BuildFileGenerator::generate(Format f, const std::string &cp3Flags)
+{
+    if ( f == Ninja )
+            return generateNinja( cp3Flags );
+    else    return generateMake( cp3Flags );
+}
+
+std::string BuildFileGenerator::generateNinja(const std::string &cp3Flags) const
+{
+    std::string toret;
+    std::string defaults;
+
+    toret += "# Generated by " + AppInfo::Name + ' ' + AppInfo::Version + "\n\n";
+    toret += "cp3 = cp3\n";
+    toret += "cp3flags = " + cp3Flags + '\n';
+    toret += "cxx = g++\n";
+    toret += "cxxflags =\n";
+    toret += "ldflags =\n\n";
+
+    toret += "rule cp3\n"
+             "  command = $cp3 $cp3flags -MF=$dep $in\n"
+             "  description = CP3 $in\n"
+             "  depfile = $dep\n"
+             "  deps = gcc\n"
+             "  restat = 1\n\n";
+    toret += "rule cxx\n"
+             "  command = $cxx $cxxflags -MMD -MF $out.d -c $in -o $out\n"
+             "  description = CXX $out\n"
+             "  depfile = $out.d\n"
+             "  deps = gcc\n\n";
+    toret += "rule link\n"
+             "  command = $cxx $in -o $out $ldflags\n"
+             "  description = LINK $out\n\n";
+
+    for(unsigned int i = 0; i < scanners.size(); ++i) {
+        const std::string &module = scanners[ i ].getFileName();
+        const std::string header = FileMan::replaceExt( module, AppInfo::CHeaderFilesExt );
+        const std::string impl = FileMan::replaceExt( module, AppInfo::CppFilesExt );
+        const std::string object = getObjectName( module );
+        ModuleSet closure;
+
+        collectImports( module, closure );
+
+        // Generation
+        toret += "build " + escapeForNinja( header ) + ' ' + escapeForNinja( impl )
+               + ": cp3 " + escapeForNinja( module ) + '\n';
+        toret += "  dep = "
+               + escapeForNinja( FileMan::replaceExt( module, AppInfo::MakeDepFilesExt ) )
+               + '\n';
+
+        // Compilation
+        toret += "build " + escapeForNinja( object ) + ": cxx " + escapeForNinja( impl )
+               + " | " + escapeForNinja( header );
+
+        for(ModuleSet::const_iterator it = closure.begin(); it != closure.end(); ++it) {
+            toret += ' ' + escapeForNinja( FileMan::replaceExt( *it, AppInfo::CHeaderFilesExt ) );
+        }
+        toret += '\n';
+
+        // Linking
+        if ( scanners[ i ].hasEntryPoint() ) {
+            const std::string exe = getExecutableName( module );
+
+            toret += "build " + escapeForNinja( exe ) + ": link " + escapeForNinja( object );
+
+            for(ModuleSet::const_iterator it = closure.begin(); it != closure.end(); ++it) {
+                toret += ' ' + escapeForNinja( getObjectName( *it ) );
+            }
+            toret += '\n';
+
+            defaults += ' ' + escapeForNinja( exe );
+        }
+
+        toret += '\n';
+    }
+
+    // Build the executables by default, or all objects if there are none
+    if ( defaults.empty() ) {
+        for(unsigned int i = 0; i < scanners.size(); ++i) {
+            defaults += ' ' + escapeForNinja( getObjectName( scanners[ i ].getFileName() ) );
+        }
+    }
+
+    if ( !defaults.empty() ) {
+        toret += "default" + defaults + '\n';
+    }
+
+    return toret;
+}
+
+std::string BuildFileGenerator::generateMake(const std::string &cp3Flags) const
+{
+    std::string rules;
+    std::string defaults;
+    std::string generated;
+    std::string depFiles;
+    std::string toret;
+
+    for(unsigned int i = 0; i < scanners.size(); ++i) {
+        const std::string &module = scanners[ i ].getFileName();
+        const std::string header = Parser::Cp3Parser::escapeForMake(
+                                FileMan::replaceExt( module, AppInfo::CHeaderFilesExt ) );
+        const std::string impl = Parser::Cp3Parser::escapeForMake(
+                                FileMan::replaceExt( module, AppInfo::CppFilesExt ) );
+        const std::string object = Parser::Cp3Parser::escapeForMake( getObjectName( module ) );
+        ModuleSet closure;
+
+        collectImports( module, closure );
+
+        // Generation
+        rules += impl + ": " + Parser::Cp3Parser::escapeForMake( module ) + '\n';
+        rules += "\t$(CP3) $(CP3FLAGS) --force $<\n";
+        rules += header + ": " + impl + " ;\n";
+
+        // Compilation
+        rules += object + ": " + impl + ' ' + header
+               + join( closure, AppInfo::CHeaderFilesExt )
+               + '\n';
+        rules += "\t$(CXX) $(CXXFLAGS) -MMD -MP -MF $@.d -c $< -o $@\n";
+
+        // Linking
+        if ( scanners[ i ].hasEntryPoint() ) {
+            const std::string exe = Parser::Cp3Parser::escapeForMake( getExecutableName( module ) );
+
+            rules += exe + ": " + object
+                   + join( closure, ".o" )
+                   + '\n';
+            rules += "\t$(CXX) $^ -o $@ $(LDFLAGS)\n";
+
+            defaults += ' ' + exe;
+            generated += ' ' + exe;
+        }
+
+        rules += '\n';
+        generated += ' ' + header + ' ' + impl + ' ' + object;
+        depFiles += ' ' + object + ".d";
+    }
+
+    // Build the executables by default, or all objects if there are none
+    if ( defaults.empty() ) {
+        for(unsigned int i = 0; i < scanners.size(); ++i) {
+            defaults += ' '
+                      + Parser::Cp3Parser::escapeForMake( getObjectName( scanners[ i ].getFileName() ) );
+        }
+    }
+
+    toret += "# Generated by " + AppInfo::Name + ' ' + AppInfo::Version + "\n\n";
+    toret += "CP3 ?= cp3\n";
+    toret += "CP3FLAGS ?= " + cp3Flags + '\n';
+    toret += "CXXFLAGS ?=\n";
+    toret += "LDFLAGS ?=\n\n";
+    toret += ".PHONY: all clean\n\n";
+    toret += "all:" + defaults + "\n\n";
+    toret += rules;
+    toret += "clean:\n\trm -f" + generated + depFiles + "\n\n";
+    toret += "-include" + depFiles + '\n';
+
+    return toret;
+}
+
+}
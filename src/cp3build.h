@@ -0,0 +1,66 @@
+#ifndef CP3BUILD_H_INCLUDED
+#define CP3BUILD_H_INCLUDED
+
+#include "cp3scanner.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+namespace Cp3mm {
+
+/**
+    Generates a build file (for Ninja or make) for a set of modules.
+    Each module gets an edge generating its header and implementation,
+    an edge compiling the implementation, depending on the headers of the
+    modules it imports, and, if it has an entry point, an edge linking it
+    with all the modules it needs.
+    @see Parser::ModuleScanner
+*/
+class BuildFileGenerator {
+public:
+    /// The available formats for build files
+    enum Format { Ninja, Make };
+
+    /// Default name for Ninja build files
+    static const std::string NinjaFileName;
+
+    /// Default name for make build files
+    static const std::string MakeFileName;
+
+    /// Creates a new generator
+    /// @param moduleFileNames The modules to build
+    BuildFileGenerator(const std::vector<std::string> &moduleFileNames);
+
+    /// Generates the build file
+    /// @param f The format of the build file
+    /// @param cp3Flags The options to pass to cp3 when generating modules
+    /// @return The contents of the build file
+    std::string generate(Format f, const std::string &cp3Flags = "");
+
+private:
+    typedef std::set<std::string> ModuleSet;
+
+    void scan();
+    void collectImports(const std::string &module, ModuleSet &closure) const;
+    std::string generateNinja(const std::string &cp3Flags) const;
+    std::string generateMake(const std::string &cp3Flags) const;
+
+    static std::string getObjectName(const std::string &module);
+    static std::string getExecutableName(const std::string &module);
+    /// Joins the file names for the modules with the given extension, escaped for make
+    static std::string join(const ModuleSet &modules, const std::string &ext);
+
+    std::vector<Parser::ModuleScanner> scanners;
+
+    /// Modules by the name of their header
+    std::map<std::string, std::string> modulesByHeader;
+
+    /// Modules directly imported (or included) by each module
+    std::map<std::string, ModuleSet> imports;
+};
+
+}
+
+#endif // CP3BUILD_H_INCLUDED
@@ -0,0 +1,82 @@
+// cp3client - Client for the cp3 server
+/*
+    Sends a command line to a running 'cp3 --server',
+    showing its answer and exiting with its exit code.
+
+    cp3client [--socket=path] [cp3 options] <filename> [<filename>...]
+*/
+
+#include "cp3protocol.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+const std::string OptSocket = "--socket=";
+
+int main(int argc, const char * argv[])
+{
+    std::string socketPath = Cp3mm::Protocol::getDefaultSocketPath();
+    std::string request;
+    std::string line;
+    bool shutdown = false;
+    char cwd[ 4096 ];
+    struct sockaddr_un address;
+    int exitCode = EXIT_FAILURE;
+    int fd;
+
+    // Prepare the request
+    if ( getcwd( cwd, sizeof( cwd ) ) != NULL ) {
+        request += Cp3mm::Protocol::CmdCwd + cwd + '\n';
+    }
+
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[ i ];
+
+        if ( arg.compare( 0, OptSocket.length(), OptSocket ) == 0 ) {
+            socketPath = arg.substr( OptSocket.length() );
+        }
+        else
+        if ( arg == "--shutdown" ) {
+            request = Cp3mm::Protocol::CmdShutdown + '\n';
+            shutdown = true;
+        }
+        else
+        if ( !shutdown ) {
+            request += Cp3mm::Protocol::CmdArg + arg + '\n';
+        }
+    }
+    request += '\n';
+
+    // Connect
+    std::memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    std::strncpy( address.sun_path, socketPath.c_str(), sizeof( address.sun_path ) - 1 );
+
+    fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd < 0
+      || connect( fd, (struct sockaddr *) &address, sizeof( address ) ) != 0 )
+    {
+        std::fprintf( stderr, "cp3client: no server at '%s'\n", socketPath.c_str() );
+        return EXIT_FAILURE;
+    }
+
+    // Send it and show the answer
+    if ( Cp3mm::Protocol::writeAll( fd, request ) ) {
+        while( Cp3mm::Protocol::readLine( fd, line ) ) {
+            if ( line.compare( 0, Cp3mm::Protocol::ReplyExit.length(), Cp3mm::Protocol::ReplyExit ) == 0 ) {
+                exitCode = std::atoi( line.c_str() + Cp3mm::Protocol::ReplyExit.length() );
+                break;
+            }
+
+            std::printf( "%s\n", line.c_str() );
+        }
+    }
+
+    close( fd );
+    return exitCode;
+}
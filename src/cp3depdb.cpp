@@ -0,0 +1,396 @@
+// cp3depdb.cpp
+/*
+    Implementation of the dependency database
+*/
+
+#include "cp3depdb.h"
+#include "cp3driver.h"
+#include "cp3protocol.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+namespace Cp3mm {
+
+const std::string DependencyDatabase::DefaultFileName = "cp3.depdb";
+const char DependencyDatabase::HeaderMagic[ 4 ] = { 'C', 'P', '3', 'H' };
+const char DependencyDatabase::Magic[ 4 ] = { 'C', 'P', '3', 'D' };
+const uint64_t DependencyDatabase::MinSizeToCompact = 64 * 1024;
+
+static const size_t HeaderSize = sizeof( DependencyDatabase::HeaderMagic ) + sizeof( uint64_t );
+
+static void appendNames(std::string &buffer, const std::vector<std::string> &names)
+{
+    for(unsigned int i = 0; i < names.size(); ++i) {
+        buffer += names[ i ];
+        buffer += '\0';
+    }
+}
+
+static void appendRaw(std::string &buffer, const void * data, size_t size)
+{
+    buffer.append( (const char *) data, size );
+}
+
+/// Reads a nul-terminated name, advancing the cursor
+static bool readName(const char * &cursor, const char * end, std::string &name)
+{
+    const char * nameEnd = (const char *) std::memchr( cursor, 0, end - cursor );
+    bool toret = false;
+
+    if ( nameEnd != NULL ) {
+        name.assign( cursor, nameEnd );
+        cursor = nameEnd + 1;
+        toret = true;
+    }
+
+    return toret;
+}
+
+/// Returns a record as stored in the file, framed and checksummed
+static std::string encode(const DependencyDatabase::Record &record)
+{
+    const uint32_t numImports = record.imports.size();
+    const uint32_t numIncludes = record.includes.size();
+    std::string payload;
+    std::string toret;
+    uint64_t checksum;
+    uint32_t size;
+
+    appendRaw( payload, &record.contentHash, sizeof( record.contentHash ) );
+    appendRaw( payload, &record.interfaceHash, sizeof( record.interfaceHash ) );
+    appendRaw( payload, &numImports, sizeof( numImports ) );
+    appendRaw( payload, &numIncludes, sizeof( numIncludes ) );
+    payload += record.module;
+    payload += '\0';
+    appendNames( payload, record.imports );
+    appendNames( payload, record.includes );
+
+    size = payload.length();
+    checksum = Driver::hash( payload );
+    appendRaw( toret, DependencyDatabase::Magic, sizeof( DependencyDatabase::Magic ) );
+    appendRaw( toret, &size, sizeof( size ) );
+    appendRaw( toret, &checksum, sizeof( checksum ) );
+    toret += payload;
+
+    return toret;
+}
+
+/// Decodes the payload of a record
+static bool decode(const char * cursor, const char * end, DependencyDatabase::Record &record)
+{
+    const size_t fixedSize = 2 * sizeof( uint64_t ) + 2 * sizeof( uint32_t );
+    uint32_t numImports;
+    uint32_t numIncludes;
+    std::string name;
+    bool toret = ( cursor + fixedSize <= end );
+
+    if ( toret ) {
+        std::memcpy( &record.contentHash, cursor, sizeof( uint64_t ) );
+        cursor += sizeof( uint64_t );
+        std::memcpy( &record.interfaceHash, cursor, sizeof( uint64_t ) );
+        cursor += sizeof( uint64_t );
+        std::memcpy( &numImports, cursor, sizeof( uint32_t ) );
+        cursor += sizeof( uint32_t );
+        std::memcpy( &numIncludes, cursor, sizeof( uint32_t ) );
+        cursor += sizeof( uint32_t );
+
+        toret = readName( cursor, end, record.module );
+
+        for(uint32_t i = 0; toret && i < numImports; ++i) {
+            toret = readName( cursor, end, name );
+            record.imports.push_back( name );
+        }
+
+        for(uint32_t i = 0; toret && i < numIncludes; ++i) {
+            toret = readName( cursor, end, name );
+            record.includes.push_back( name );
+        }
+    }
+
+    return toret;
+}
+
+/// Returns the header of the file, holding the size of the file when dead records were counted
+static std::string encodeHeader(uint64_t checkedSize)
+{
+    std::string toret;
+
+    appendRaw( toret, DependencyDatabase::HeaderMagic, sizeof( DependencyDatabase::HeaderMagic ) );
+    appendRaw( toret, &checkedSize, sizeof( checkedSize ) );
+
+    return toret;
+}
+
+/// Decodes the header of the file
+/// @return The size of the file when dead records were counted, 0 if there is no header
+static uint64_t decodeHeader(const std::string &header)
+{
+    uint64_t toret = 0;
+
+    if ( header.length() >= HeaderSize
+      && header.compare( 0, sizeof( DependencyDatabase::HeaderMagic ),
+                         DependencyDatabase::HeaderMagic, sizeof( DependencyDatabase::HeaderMagic ) ) == 0 )
+    {
+        std::memcpy( &toret, header.data() + sizeof( DependencyDatabase::HeaderMagic ), sizeof( toret ) );
+    }
+
+    return toret;
+}
+
+/// Decodes all records, the last ones replacing the first ones
+/// @return The number of dead records
+static unsigned int decodeAll(const std::string &contents, DependencyDatabase::Records &records)
+{
+    const char * const magic = DependencyDatabase::Magic;
+    const char * const magicEnd = magic + sizeof( DependencyDatabase::Magic );
+    const size_t headerSize = sizeof( DependencyDatabase::Magic ) + sizeof( uint32_t ) + sizeof( uint64_t );
+    const char * cursor = contents.data();
+    const char * const end = cursor + contents.length();
+    unsigned int numRecords = 0;
+    unsigned int numDamaged = 0;
+
+    records.clear();
+
+    if ( decodeHeader( contents ) > 0 ) {
+        cursor += HeaderSize;
+    }
+
+    while( cursor < end ) {
+        DependencyDatabase::Record record;
+        const char * payload = cursor + headerSize;
+        uint32_t size = 0;
+        uint64_t checksum = 0;
+        bool ok = ( payload <= end
+                 && std::equal( magic, magicEnd, cursor ) );
+
+        if ( ok ) {
+            std::memcpy( &size, cursor + sizeof( DependencyDatabase::Magic ), sizeof( size ) );
+            std::memcpy( &checksum, cursor + sizeof( DependencyDatabase::Magic ) + sizeof( size ), sizeof( checksum ) );
+
+            ok = ( size <= (size_t) ( end - payload )
+                && Driver::hash( std::string( payload, size ) ) == checksum
+                && decode( payload, payload + size, record ) );
+        }
+
+        if ( ok ) {
+            records[ record.module ] = record;
+            ++numRecords;
+            cursor = payload + size;
+        } else {
+            // Damaged: go on from the next record
+            ++numDamaged;
+            cursor = std::search( cursor + 1, end, magic, magicEnd );
+        }
+    }
+
+    return ( numRecords - records.size() ) + numDamaged;
+}
+
+/// Opens the database and locks it, making sure it was not replaced
+/// (compacted) by another process while waiting for the lock
+/// @return The file descriptor, negative if it cannot be opened
+static int openLocked(const std::string &fileName, int flags, int lock)
+{
+    struct stat infoFd;
+    struct stat infoName;
+    int toret;
+
+    for(;;) {
+        toret = open( fileName.c_str(), flags, 0666 );
+
+        if ( toret < 0 ) {
+            break;
+        }
+
+        flock( toret, lock );
+
+        if ( fstat( toret, &infoFd ) != 0
+          || stat( fileName.c_str(), &infoName ) != 0
+          || ( infoFd.st_dev == infoName.st_dev
+            && infoFd.st_ino == infoName.st_ino ) )
+        {
+            break;
+        }
+
+        flock( toret, LOCK_UN );
+        close( toret );
+    }
+
+    return toret;
+}
+
+/// Reads all the contents of a file descriptor
+static bool readAll(int fd, std::string &contents)
+{
+    char buffer[ 65536 ];
+    ssize_t numRead;
+
+    contents.clear();
+
+    while( ( numRead = read( fd, buffer, sizeof( buffer ) ) ) != 0 ) {
+        if ( numRead < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+
+            break;
+        }
+
+        contents.append( buffer, numRead );
+    }
+
+    return ( numRead == 0 );
+}
+
+void DependencyDatabase::append(const Record &record) const
+{
+    // Prepare the whole record, so it is written at once
+    std::string buffer = encode( record );
+    std::string header( HeaderSize, '\0' );
+    uint64_t size = 0;
+    uint64_t checkedSize = 0;
+    struct stat info;
+    bool ok;
+
+    // Append it, excluding other writers
+    int fd = openLocked( fileName, O_RDWR | O_APPEND | O_CREAT, LOCK_EX );
+
+    if ( fd < 0 ) {
+        throw std::runtime_error( "unable to open '" + fileName + "' file" );
+    }
+
+    if ( fstat( fd, &info ) == 0 ) {
+        size = info.st_size;
+    }
+
+    // A new database starts with its header
+    if ( size == 0 ) {
+        buffer = encodeHeader( HeaderSize ) + buffer;
+    }
+    else
+    if ( pread( fd, &header[ 0 ], HeaderSize, 0 ) == (ssize_t) HeaderSize ) {
+        checkedSize = decodeHeader( header );
+    }
+
+    ok = Protocol::writeAll( fd, buffer );
+    size += buffer.length();
+
+    flock( fd, LOCK_UN );
+    close( fd );
+
+    if ( !ok ) {
+        throw std::runtime_error( "unable to write '" + fileName + "' file" );
+    }
+
+    // Count the dead records only from time to time, as it means reading it all
+    if ( size >= MinSizeToCompact
+      && size > 2 * checkedSize )
+    {
+        compact();
+    }
+}
+
+unsigned int DependencyDatabase::load(Records &records) const
+{
+    std::string contents;
+    bool ok;
+
+    // Read it all, while no record is being appended
+    int fd = openLocked( fileName, O_RDONLY, LOCK_SH );
+
+    records.clear();
+
+    if ( fd < 0 ) {
+        throw std::runtime_error( "unable to read '" + fileName + "' file" );
+    }
+
+    ok = readAll( fd, contents );
+
+    flock( fd, LOCK_UN );
+    close( fd );
+
+    if ( !ok ) {
+        throw std::runtime_error( "unable to read '" + fileName + "' file" );
+    }
+
+    return decodeAll( contents, records );
+}
+
+bool DependencyDatabase::compact(bool force) const
+{
+    const std::string tempFileName = fileName + ".tmp";
+    std::string contents;
+    Records records;
+    unsigned int numDead;
+    bool toret = false;
+    bool ok = true;
+
+    // Writers wait until the compacted database replaces the old one
+    int fd = openLocked( fileName, O_RDWR, LOCK_EX );
+
+    if ( fd < 0 ) {
+        throw std::runtime_error( "unable to read '" + fileName + "' file" );
+    }
+
+    if ( readAll( fd, contents ) ) {
+        numDead = decodeAll( contents, records );
+        toret = ( numDead > 0
+               && ( force
+                 || numDead > records.size() ) );
+    }
+    else ok = false;
+
+    if ( toret ) {
+        // Write the live records in a new file, replacing the old one at once
+        int tempFd = open( tempFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+        std::string live;
+
+        for(Records::const_iterator it = records.begin(); it != records.end(); ++it) {
+            live += encode( it->second );
+        }
+
+        ok = ( tempFd >= 0
+            && Protocol::writeAll( tempFd, encodeHeader( HeaderSize + live.length() ) + live ) );
+
+        if ( tempFd >= 0
+          && close( tempFd ) != 0 )
+        {
+            ok = false;
+        }
+
+        ok = ( ok
+            && std::rename( tempFileName.c_str(), fileName.c_str() ) == 0 );
+
+        if ( !ok ) {
+            std::remove( tempFileName.c_str() );
+        }
+    }
+    else
+    if ( ok ) {
+        // Remember the size, so records are not counted again until it grows
+        const std::string header = encodeHeader( contents.length() );
+
+        if ( decodeHeader( contents ) > 0 ) {
+            ok = ( pwrite( fd, header.data(), header.length(), 0 ) == (ssize_t) header.length() );
+        }
+    }
+
+    flock( fd, LOCK_UN );
+    close( fd );
+
+    if ( !ok ) {
+        throw std::runtime_error( "unable to compact '" + fileName + "' file" );
+    }
+
+    return toret;
+}
+
+}
@@ -0,0 +1,109 @@
+#ifndef CP3DEPDB_H_INCLUDED
+#define CP3DEPDB_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+namespace Cp3mm {
+
+/**
+    A database of the dependencies of all modules, in a single binary file,
+    meant to replace one .dep file per module in big projects.
+    Each generation appends a record for the module, so writing is cheap,
+    and several processes can write at the same time (appends are locked).
+    When read, the last record of each module is the one taken into account.
+    The file starts with a header:
+        Magic       4 bytes
+        Checked     the size of the file when its dead records were last counted, 64 bits
+    Each record is:
+        Magic       4 bytes
+        Size        the size of the payload, 32 bits
+        Checksum    the hash of the payload (FNV-1a), 64 bits
+        Payload:
+          Hashes    the content hash and the interface hash, 64 bits each
+          Counts    the number of imports and includes, 32 bits each
+          Names     the module, its imports and includes, nul-terminated
+    Damaged records (i.e., partially written by a process that crashed)
+    are skipped, reading on from the next magic.
+    The records superseded by later ones, or damaged, are dead. They are
+    removed compacting the database: rewriting the last record of each module.
+    This is done when exporting it, or when appending makes the file twice
+    as large as when dead records were last counted, and most are dead.
+*/
+class DependencyDatabase {
+public:
+    /// Default name for the database file
+    static const std::string DefaultFileName;
+
+    /// Marks the beginning of the file
+    static const char HeaderMagic[ 4 ];
+
+    /// Marks the beginning of each record
+    static const char Magic[ 4 ];
+
+    /// The minimum size of the file for dead records to be counted when appending
+    static const uint64_t MinSizeToCompact;
+
+    /// The information stored for each module
+    struct Record {
+        /// The file name of the module, relative to the current directory
+        std::string module;
+
+        /// The hash of the module source
+        uint64_t contentHash;
+
+        /// The hash of the interface of the module (its header)
+        uint64_t interfaceHash;
+
+        /// The headers of the imported modules
+        std::vector<std::string> imports;
+
+        /// The files included
+        std::vector<std::string> includes;
+
+        Record()
+            : contentHash( 0 ), interfaceHash( 0 )
+            {}
+    };
+
+    /// The records, by module
+    typedef std::map<std::string, Record> Records;
+
+    /// Creates a database stored in a given file
+    /// @param fn The name of the file
+    DependencyDatabase(const std::string &fn)
+        : fileName( fn )
+        {}
+
+    /// Appends a record for a module, superseding the previous ones,
+    /// compacting the database if it grew too much
+    /// @param record The record to append
+    /// @throw std::runtime_error if it cannot be written
+    void append(const Record &record) const;
+
+    /// Reads all the records, keeping the last one for each module
+    /// @param records The map in which to store the records
+    /// @return The number of dead records, superseded by later ones or damaged
+    /// @throw std::runtime_error if the database cannot be read
+    unsigned int load(Records &records) const;
+
+    /// Rewrites the database with only the last record of each module,
+    /// if there are more dead records than live ones, or always if forced
+    /// @param force Compact even if there are few dead records
+    /// @return true if the database was rewritten
+    /// @throw std::runtime_error if the database cannot be read or written
+    bool compact(bool force = false) const;
+
+    /// Returns the name of the file
+    const std::string &getFileName() const
+        { return fileName; }
+
+private:
+    std::string fileName;
+};
+
+}
+
+#endif // CP3DEPDB_H_INCLUDED
@@ -0,0 +1,1803 @@
+// cp3driver.cpp
+/*
+    Implementation of the driver: options and processing of modules
+*/
+
+#include "cp3driver.h"
+#include "cp3server.h"
+#include "cp3watcher.h"
+#include "cp3build.h"
+#include "cp3scanner.h"
+#include "cp3resolver.h"
+#include "cp3index.h"
+#include "cp3depdb.h"
+#include "cp3symbols.h"
+#include "cp3hierarchy.h"
+#include "cp3layout.h"
+#include "cp3pool.h"
+#include "cp3parser.h"
+#include "appinfo.h"
+#include "fileio.h"
+#include "fileman.h"
+#include "stringman.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <stdexcept>
+#include <memory>
+#include <algorithm>
+#include <set>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace Cp3mm {
+
+const std::string OptForce   = "force";
+const std::string OptVersion = "version";
+const std::string OptVerbose = "verbose";
+const std::string OptHelp    = "help";
+const std::string OptLevel   = "level=";
+const std::string OptServer  = "server";
+const std::string OptSocket  = "server=";
+const std::string OptWatch   = "watch";
+const std::string OptMD      = "md";
+const std::string OptMF      = "mf=";
+const std::string OptNinja   = "emit-ninja";
+const std::string OptNinjaFile = "emit-ninja=";
+const std::string OptMake    = "emit-make";
+const std::string OptMakeFile = "emit-make=";
+const std::string OptStdout  = "stdout";
+const std::string OptHeaderFd = "header-fd=";
+const std::string OptImplFd  = "impl-fd=";
+const std::string OptModule  = "module=";
+const std::string OptScanDeps = "scan-deps";
+const std::string OptScanDepsFile = "scan-deps=";
+const std::string OptJobs    = "jobs=";
+const std::string OptOutDir  = "outdir=";
+const std::string OptSearchPath = "I";
+const std::string OptRecursive = "recursive";
+const std::string OptIndex   = "index";
+const std::string OptIndexFile = "index=";
+const std::string OptAffected = "affected";
+const std::string OptAffectedFile = "affected=";
+const std::string OptDepDb   = "depdb";
+const std::string OptDepDbFile = "depdb=";
+const std::string OptExportDeps = "export-deps";
+const std::string OptExportDepsFile = "export-deps=";
+const std::string OptSymbols = "symbols";
+const std::string OptStale   = "stale";
+const std::string OptPrivateImpl = "private-impl";
+const std::string OptMoveImports = "move-imports";
+const std::string OptFwdDecls = "fwd-decls";
+const std::string OptInlinePolicy = "inline-policy";
+const std::string OptInlinePolicyLimits = "inline-policy=";
+const std::string OptConstexpr = "constexpr";
+const std::string OptConstexprInline = "constexpr=";
+const std::string ArgInlineConstants = "inline";
+const std::string OptCharArrays = "char-arrays";
+const std::string OptInitReport = "init-report";
+const std::string OptSeal    = "seal";
+const std::string OptSealExclude = "seal-exclude=";
+const std::string OptPackFields = "pack-fields";
+const std::string OptPackFieldsTable = "pack-fields=";
+const std::string OptFieldSizes = "field-sizes=";
+const std::string OptLayoutBudget = "layout-budget=";
+
+const std::string StdinPath = "/dev/stdin";
+const std::string StdinModuleName = "stdin";
+const std::string InterfaceComment = "# interface ";
+
+const std::string MsgHelp =
+    "cp3 [options] <filename> [<filename>...]\n"
+    "\t--help   \tShows this message and exits\n"
+    "\t--version\tShows version and copyright information and exits\n"
+    "\t--force  \tGenerate files ignoring timestap check\n"
+    "\t--level=x  \tPuts strictness of the preprocessor at level x (=1,2,3)\n"
+    "\t--server[=path]\tRuns as a daemon, attending cp3client at the local socket path\n"
+    "\t--watch [<dir>...]\tRegenerates the modules in the directories as they change\n"
+    "\t-MD     \tWrites a Makefile/Ninja dependency file (X.d) for each module\n"
+    "\t-MF=file\tWrites the Makefile/Ninja dependency rules in that file\n"
+    "\t--emit-ninja[=file]\tWrites a Ninja build file for the modules (build.ninja)\n"
+    "\t--emit-make[=file]\tWrites a make build file for the modules (cp3.mk)\n"
+    "\t--stdout  \tWrites the header and the implementation to standard output\n"
+    "\t--header-fd=n\tWrites the header to file descriptor n\n"
+    "\t--impl-fd=n\tWrites the implementation to file descriptor n\n"
+    "\t--module=name\tName of the module read from standard input ('-')\n"
+    "\t--scan-deps[=file]\tOnly lists the imports and includes of each module\n"
+    "\t--jobs=n  \tUses n threads (as many as processors by default)\n"
+    "\t--outdir=dir\tWrites generated files in dir, mirroring the paths of modules\n"
+    "\t-Idir     \tLooks for imported modules in dir, failing when not found\n"
+    "\t--recursive\tAlso generates the imported modules, when out of date\n"
+    "\t--index[=file]\tWrites the index of importers of the modules (cp3.idx)\n"
+    "\t--affected[=file]\tLists the modules and headers affected by changes in the modules\n"
+    "\t--depdb[=file]\tStores dependencies in a single database (cp3.depdb), not in .dep files\n"
+    "\t--export-deps[=file]\tCompacts the database, and writes the .dep files of all its modules\n"
+    "\t--symbols\tWrites the symbols exported and used by each module (X.sym)\n"
+    "\t--stale  \tLists the modules using symbols changed in the modules they import\n"
+    "\t--private-impl\tDeclares private namespace members and classes in the implementation\n"
+    "\t--move-imports\tIncludes the imported modules not used in the header only in the implementation\n"
+    "\t--fwd-decls\tAs --move-imports, also forward declaring imported classes only used\n"
+    "\t          \tin prototypes, or by pointer or reference\n"
+    "\t--inline-policy[=n,m]\tPlaces straight code of up to n statements (1) in the header,\n"
+    "\t          \tand inline code of more than m statements (4) in the implementation\n"
+    "\t--constexpr[=inline]\tDefines constants initialized with literals as constexpr\n"
+    "\t          \t(inline constexpr, for C++17) in the header\n"
+    "\t--char-arrays\tStores std::string statics initialized with string literals as const char arrays\n"
+    "\t--init-report\tLists the statics initialized at startup, and what it costs\n"
+    "\t--seal    \tMakes final the classes not derived from in the modules given,\n"
+    "\t          \tand the virtual methods not overridden (implies --force)\n"
+    "\t--seal-exclude=A,B\tDoes not make final classes A and B, nor the ones in namespaces A and B\n"
+    "\t--pack-fields[=file]\tWrites the private and protected fields at the end of classes,\n"
+    "\t          \tsorted by alignment, reading the sizes of types in file (type size [alignment]);\n"
+    "\t          \tnot for classes whose constructors initialize fields with other fields\n"
+    "\t--field-sizes=file\tReads the sizes of types in file, as --pack-fields, without packing\n"
+    "\t--layout-budget=file\tChecks the size and alignment of classes with static assertions,\n"
+    "\t          \treading them in file (class size [alignment]), and reports the estimated deltas\n"
+;
+
+// ==================================================================== Options
+const unsigned int Options::DefaultMaxStatementsInlined = 1;
+const unsigned int Options::DefaultMaxStatementsKeptInline = 4;
+
+void Options::process(int argc, const char * argv[])
+{
+    unsigned int lengthErase = 1;
+    unsigned int firstArg = 1;
+
+    for(; firstArg < (unsigned int) argc; ++firstArg) {
+        std::string opt = argv[ firstArg ];
+        std::string arg;
+
+        // Maybe it is time to exit
+        if ( opt.empty()
+          || opt[ 0 ] != '-'
+          || opt == Driver::StdinFileName )
+        {
+            break;
+        }
+
+        // Erase all '-'
+        lengthErase = 1;
+        if ( opt.length() > 1
+          && opt[ 1 ] == '-' )
+        {
+            lengthErase = 2;
+        }
+        opt.erase( 0, lengthErase );
+
+        // Search paths: -Idir or -I=dir
+        if ( lengthErase == 1
+          && opt.compare( 0, OptSearchPath.length(), OptSearchPath ) == 0 )
+        {
+            arg = opt.substr( OptSearchPath.length() );
+
+            if ( !arg.empty()
+              && arg[ 0 ] == '=' )
+            {
+                arg.erase( 0, 1 );
+            }
+
+            if ( arg.empty() ) {
+                throw std::runtime_error( "missing directory for -I" );
+            }
+
+            searchPaths.push_back( arg );
+            continue;
+        }
+
+        // Separate the argument of the option, if any
+        std::string::size_type posArg = opt.find( '=' );
+        if ( posArg != std::string::npos ) {
+            arg = opt.substr( posArg + 1 );
+            opt.erase( posArg + 1 );
+        }
+
+        // Look for option
+        StringMan::minsCnvt( opt );
+
+        if ( opt == OptHelp ) {
+            help = true;
+        }
+        else
+        if( opt == OptVersion ) {
+            version = true;
+        }
+        else
+        if ( opt == OptForce ) {
+            force = true;
+        }
+        else
+        if( opt == OptVerbose ) {
+            verbose = true;
+        }
+        else
+        if ( opt == OptLevel
+          && !arg.empty() )
+        {
+            strictness = (Tds::Entity::Strictness) ( ( arg[ arg.length() -1 ] - '0' ) - 1 );
+        }
+        else
+        if ( opt == OptServer ) {
+            server = true;
+        }
+        else
+        if ( opt == OptSocket ) {
+            server = true;
+            socketPath = arg;
+        }
+        else
+        if ( opt == OptWatch ) {
+            watch = true;
+        }
+        else
+        if ( opt == OptMD ) {
+            makeDeps = true;
+        }
+        else
+        if ( opt == OptMF
+          && !arg.empty() )
+        {
+            makeDeps = true;
+            makeDepsFileName = arg;
+        }
+        else
+        if ( opt == OptNinja ) {
+            ninjaFileName = BuildFileGenerator::NinjaFileName;
+        }
+        else
+        if ( opt == OptNinjaFile
+          && !arg.empty() )
+        {
+            ninjaFileName = arg;
+        }
+        else
+        if ( opt == OptMake ) {
+            makeFileName = BuildFileGenerator::MakeFileName;
+        }
+        else
+        if ( opt == OptMakeFile
+          && !arg.empty() )
+        {
+            makeFileName = arg;
+        }
+        else
+        if ( opt == OptStdout ) {
+            toStdout = true;
+        }
+        else
+        if ( opt == OptHeaderFd
+          && !arg.empty() )
+        {
+            headerFd = std::atoi( arg.c_str() );
+        }
+        else
+        if ( opt == OptImplFd
+          && !arg.empty() )
+        {
+            implFd = std::atoi( arg.c_str() );
+        }
+        else
+        if ( opt == OptModule
+          && !arg.empty() )
+        {
+            moduleName = arg;
+        }
+        else
+        if ( opt == OptScanDeps ) {
+            scanDeps = true;
+        }
+        else
+        if ( opt == OptScanDepsFile
+          && !arg.empty() )
+        {
+            scanDeps = true;
+            scanDepsFileName = arg;
+        }
+        else
+        if ( opt == OptJobs
+          && !arg.empty() )
+        {
+            numJobs = std::atoi( arg.c_str() );
+        }
+        else
+        if ( opt == OptIndex
+          || opt == OptIndexFile )
+        {
+            buildIndex = true;
+            indexFileName = arg;
+        }
+        else
+        if ( opt == OptAffected
+          || opt == OptAffectedFile )
+        {
+            queryIndex = true;
+            indexFileName = arg;
+        }
+        else
+        if ( opt == OptDepDb
+          || opt == OptDepDbFile )
+        {
+            useDepDb = true;
+            depDbFileName = arg;
+        }
+        else
+        if ( opt == OptExportDeps
+          || opt == OptExportDepsFile )
+        {
+            exportDepDb = true;
+            depDbFileName = arg;
+        }
+        else
+        if ( opt == OptSymbols ) {
+            trackSymbols = true;
+        }
+        else
+        if ( opt == OptStale ) {
+            checkSymbols = true;
+        }
+        else
+        if ( opt == OptPrivateImpl ) {
+            privateInImpl = true;
+        }
+        else
+        if ( opt == OptMoveImports ) {
+            moveImports = true;
+        }
+        else
+        if ( opt == OptFwdDecls ) {
+            moveImports = true;
+            forwardDeclarations = true;
+        }
+        else
+        if ( opt == OptInlinePolicy ) {
+            inliningPolicy = true;
+        }
+        else
+        if ( opt == OptInlinePolicyLimits
+          && !arg.empty() )
+        {
+            std::string::size_type posComma = arg.find( ',' );
+
+            inliningPolicy = true;
+            maxStatementsInlined = std::atoi( arg.c_str() );
+
+            if ( posComma != std::string::npos ) {
+                maxStatementsKeptInline = std::atoi( arg.c_str() + posComma + 1 );
+            }
+        }
+        else
+        if ( opt == OptConstexpr ) {
+            constexprConstants = true;
+        }
+        else
+        if ( opt == OptConstexprInline
+          && arg == ArgInlineConstants )
+        {
+            constexprConstants = true;
+            inlineConstants = true;
+        }
+        else
+        if ( opt == OptCharArrays ) {
+            charArrays = true;
+        }
+        else
+        if ( opt == OptInitReport ) {
+            reportInitializers = true;
+        }
+        else
+        if ( opt == OptSeal ) {
+            seal = true;
+            force = true;
+        }
+        else
+        if ( opt == OptSealExclude
+          && !arg.empty() )
+        {
+            std::string::size_type pos = 0;
+            std::string::size_type posComma;
+
+            do {
+                posComma = arg.find( ',', pos );
+                sealExcluded.push_back( arg.substr( pos, posComma - pos ) );
+                pos = posComma + 1;
+            } while( posComma != std::string::npos );
+        }
+        else
+        if ( opt == OptPackFields ) {
+            packFields = true;
+        }
+        else
+        if ( opt == OptPackFieldsTable
+          && !arg.empty() )
+        {
+            packFields = true;
+            fieldSizesFileName = arg;
+        }
+        else
+        if ( opt == OptFieldSizes
+          && !arg.empty() )
+        {
+            fieldSizesFileName = arg;
+        }
+        else
+        if ( opt == OptLayoutBudget
+          && !arg.empty() )
+        {
+            layoutBudgetsFileName = arg;
+        }
+        else
+        if ( opt == OptRecursive ) {
+            recursive = true;
+        }
+        else
+        if ( opt == OptOutDir
+          && !arg.empty() )
+        {
+            outputDir = arg;
+        }
+        else throw std::runtime_error( "invalid option" );
+    }
+
+    if ( indexFileName.empty() ) {
+        indexFileName = ReverseIndex::DefaultFileName;
+    }
+
+    if ( depDbFileName.empty() ) {
+        depDbFileName = DependencyDatabase::DefaultFileName;
+    }
+
+    // Whatever is not sent to a descriptor goes to standard output
+    if ( toStdout ) {
+        if ( headerFd < 0 ) {
+            headerFd = STDOUT_FILENO;
+        }
+
+        if ( implFd < 0 ) {
+            implFd = STDOUT_FILENO;
+        }
+    }
+
+    // The remaining arguments are the files to process
+    for(; firstArg < (unsigned int) argc; ++firstArg) {
+        inputFileNames.push_back( argv[ firstArg ] );
+    }
+}
+
+std::string Options::getSignature() const
+{
+    std::string toret;
+
+    // File names in options are relative to the current directory
+    toret += Driver::getAbsoluteFileName( "." ) + '\n';
+
+    // A character per flag
+    toret += (char) ( '0' + strictness );
+    toret += makeDeps ? 'd' : '-';
+    toret += useDepDb ? 'b' : '-';
+    toret += trackSymbols ? 's' : '-';
+    toret += privateInImpl ? 'p' : '-';
+    toret += moveImports ? 'm' : '-';
+    toret += forwardDeclarations ? 'f' : '-';
+    toret += inliningPolicy ? 'i' : '-';
+    toret += constexprConstants ? 'c' : '-';
+    toret += inlineConstants ? 'v' : '-';
+    toret += charArrays ? 'a' : '-';
+    toret += seal ? 'x' : '-';
+    toret += packFields ? 'k' : '-';
+    toret += ' ' + StringMan::toString( maxStatementsInlined );
+    toret += ' ' + StringMan::toString( maxStatementsKeptInline );
+    toret += '\n';
+
+    // Files and directories
+    toret += makeDepsFileName + '\n';
+    toret += depDbFileName + '\n';
+    toret += fieldSizesFileName + '\n';
+    toret += layoutBudgetsFileName + '\n';
+
+    for(unsigned int i = 0; i < searchPaths.size(); ++i) {
+        toret += searchPaths[ i ] + '\n';
+    }
+
+    for(unsigned int i = 0; i < sealExcluded.size(); ++i) {
+        toret += sealExcluded[ i ] + '\n';
+    }
+
+    return toret;
+}
+
+// ===================================================================== Driver
+const std::string Driver::StdinFileName = "-";
+
+/// Splits a path in its components, resolving "." and ".." when possible
+static std::vector<std::string> splitPath(const std::string &path)
+{
+    std::vector<std::string> toret;
+    std::string::size_type pos = 0;
+    std::string::size_type posEnd;
+
+    while( pos <= path.length() ) {
+        posEnd = path.find( '/', pos );
+
+        if ( posEnd == std::string::npos ) {
+            posEnd = path.length();
+        }
+
+        const std::string component = path.substr( pos, posEnd - pos );
+
+        if ( component == ".."
+          && !toret.empty()
+          && toret.back() != ".." )
+        {
+            toret.pop_back();
+        }
+        else
+        if ( !component.empty()
+          && component != "." )
+        {
+            toret.push_back( component );
+        }
+
+        pos = posEnd + 1;
+    }
+
+    return toret;
+}
+
+/// Returns the absolute, normalized path of a directory
+static std::vector<std::string> getAbsolutePath(const std::string &dir)
+{
+    std::string path = dir;
+
+    if ( path.empty()
+      || path[ 0 ] != '/' )
+    {
+        char buffer[ 4096 ];
+
+        if ( getcwd( buffer, sizeof( buffer ) ) == NULL ) {
+            throw std::runtime_error( "unable to determine the current directory" );
+        }
+
+        path = std::string( buffer ) + '/' + path;
+    }
+
+    return splitPath( path );
+}
+
+/// Saves the dependencies of a module (.dep), one per line, preceded
+/// by the fingerprint of its interface, as a comment
+static void saveDependencies(const std::string &fileName,
+                             uint64_t fingerprint,
+                             const std::vector<std::string> &deps)
+{
+    std::string contents = Driver::getInterfaceComment( fingerprint );
+
+    for(unsigned int i = 0; i < deps.size(); ++i) {
+        contents += deps[ i ] + '\n';
+    }
+
+    Driver::writeFile( fileName, contents );
+}
+
+static bool isUpdated(
+    const InputFile &in,
+    const std::string &outHeaderName,
+    const std::string &outImplName)
+{
+    bool toret = false;
+
+    InputFile out1( outHeaderName );
+    InputFile out2( outImplName );
+
+    // The header is left untouched when its interface does not change,
+    // so only the implementation tells when the module was generated
+    if ( in.isOpen()
+      && out1.isOpen()
+      && out2.isOpen() )
+    {
+        toret = ( out2.getTimeStamp() >= in.getTimeStamp() );
+    }
+
+    return toret;
+}
+
+/// Generates each of the modules in a list
+class GenerationTask : public WorkerPool::Task {
+public:
+    GenerationTask(Driver &d, const Options &o, const std::vector<std::string> &m)
+        : driver( d ), opts( o ), modules( m )
+        {}
+
+    bool run(unsigned int i)
+        { return driver.processFile( modules[ i ], opts ); }
+
+private:
+    Driver &driver;
+    const Options &opts;
+    const std::vector<std::string> &modules;
+};
+
+Driver::Driver(FILE * out)
+    : output( out ), keepWarm( false )
+{
+    pthread_mutex_init( &mutex, NULL );
+}
+
+Driver::~Driver()
+{
+    pthread_mutex_destroy( &mutex );
+}
+
+void Driver::forgetImports()
+{
+    Lock lock( mutex );
+    resolver.reset();
+    interfaces.clear();
+}
+
+ImportResolver * Driver::getImportResolver(const Options &opts)
+{
+    Lock lock( mutex );
+
+    if ( resolver.get() == NULL ) {
+        resolver.reset( new ImportResolver( opts ) );
+    }
+
+    return resolver.get();
+}
+
+bool Driver::processRecursively(const Options &opts)
+{
+    ImportResolver &modules = *getImportResolver( opts );
+    std::vector<std::string> pending;
+    std::vector<std::string> closure;
+    std::set<std::string> visited;
+
+    // Find all imported (or included) modules, each one once
+    for(unsigned int i = 0; i < opts.inputFileNames.size(); ++i) {
+        const std::string &fileName = opts.inputFileNames[ i ];
+
+        pending.push_back( getNormalizedFileName( fileName ) );
+    }
+
+    while( !pending.empty() ) {
+        const std::string module = pending.back();
+        pending.pop_back();
+
+        if ( !visited.insert( module ).second ) {
+            continue;
+        }
+
+        closure.push_back( module );
+
+        if ( AppInfo::isAcceptedExt( FileMan::getExt( module ) ) ) {
+            Parser::ModuleScanner scanner( module, true );
+            Parser::ModuleScanner::Headers headers;
+            const std::string dir = getDirectory( module );
+            std::string source;
+
+            scanner.scan();
+            headers = scanner.getImports();
+            headers.insert( headers.end(),
+                            scanner.getIncludes().begin(),
+                            scanner.getIncludes().end() );
+
+            for(unsigned int i = 0; i < headers.size(); ++i) {
+                if ( modules.findModule( headers[ i ], dir, source ) ) {
+                    pending.push_back( source );
+                }
+            }
+        }
+    }
+
+    // Generating a module does not need its imports, so all go in parallel
+    GenerationTask task( *this, opts, closure );
+
+    return WorkerPool::run( task, closure.size(), opts.numJobs );
+}
+
+int Driver::run(int argc, const char * argv[])
+{
+    FILE * const oldOutput = output;
+    Options opts;
+    int toret = EXIT_SUCCESS;
+
+    try {
+        // Explore command-line options
+        opts.process( argc, argv );
+
+        // Results may be written to standard output, so messages go to stderr
+        if ( opts.usesStdout() ) {
+            if ( output != stdout ) {
+                throw std::runtime_error( "streaming is only available from the command line" );
+            }
+
+            output = stderr;
+        }
+
+        // Welcome
+        std::fprintf( output, "%s", AppInfo::TitleMessage.c_str() );
+        std::fprintf( output, " (%s %s)\n\n", AppInfo::Name.c_str(), AppInfo::Version.c_str() );
+
+        // Directories are read again in each run
+        forgetImports();
+
+        // Answer command-line options
+
+        if ( opts.version ) {
+            std::fprintf( output, "%s (%s) by %s - %s\n\n",
+                    AppInfo::Name.c_str(), AppInfo::Version.c_str(),
+                    AppInfo::Author.c_str(), AppInfo::Copyright.c_str()
+            );
+            goto End;
+        }
+
+        if ( opts.help ) {
+            std::fprintf( output, "%s\n", MsgHelp.c_str() );
+            goto End;
+        }
+
+        // Report, if needed
+        if ( opts.strictness == Tds::Entity::ErroneousStrictness ) {
+            opts.strictness = Tds::Entity::MediumStrictness;
+        }
+
+        if ( opts.verbose ) {
+            std::fprintf( output, "Force: %s\tStrict level: %s\n\n",
+                    opts.force? "yes" : "no",
+                    Tds::Entity::cnvtStrictnessToString( opts.strictness ).c_str()
+            );
+        }
+
+        // Become a daemon, if asked to
+        if ( opts.server ) {
+            if ( opts.socketPath.empty() ) {
+                opts.socketPath = Protocol::getDefaultSocketPath();
+            }
+
+            Server server( *this, opts.socketPath );
+            toret = server.serve();
+            goto End;
+        }
+
+        // Watch directories, if asked to
+        if ( opts.watch ) {
+            Watcher watcher( *this, opts );
+
+            if ( opts.inputFileNames.empty() ) {
+                watcher.addDirectory( "." );
+            }
+
+            for(unsigned int i = 0; i < opts.inputFileNames.size(); ++i) {
+                watcher.addDirectory( opts.inputFileNames[ i ] );
+            }
+
+            toret = watcher.watch();
+            goto End;
+        }
+
+        // Only scan dependencies, if asked to
+        if ( opts.scanDeps ) {
+            scanDependencies( opts );
+            goto End;
+        }
+
+        // Maintain or query the reverse index, if asked to
+        if ( opts.buildIndex ) {
+            ReverseIndex::build( opts.indexFileName, opts.inputFileNames,
+                                 opts, *getImportResolver( opts ) );
+            std::fprintf( output, "Written '%s'\n", opts.indexFileName.c_str() );
+            goto End;
+        }
+
+        if ( opts.queryIndex ) {
+            queryAffected( opts );
+            goto End;
+        }
+
+        // List the modules to recompile, if asked to
+        if ( opts.checkSymbols ) {
+            checkSymbols( opts );
+            goto End;
+        }
+
+        // Export the dependency database, if asked to
+        if ( opts.exportDepDb ) {
+            exportDependencies( opts );
+            goto End;
+        }
+
+        // Write build files, if asked to
+        if ( !opts.ninjaFileName.empty()
+          || !opts.makeFileName.empty() )
+        {
+            BuildFileGenerator generator( opts.inputFileNames );
+            std::string cp3Flags;
+
+            if ( opts.strictness != Tds::Entity::MediumStrictness ) {
+                cp3Flags = "--" + OptLevel + (char) ( '1' + opts.strictness );
+            }
+
+            if ( !opts.ninjaFileName.empty() ) {
+                writeFile( opts.ninjaFileName,
+                           generator.generate( BuildFileGenerator::Ninja, cp3Flags ) );
+                std::fprintf( output, "Written '%s'\n", opts.ninjaFileName.c_str() );
+            }
+
+            if ( !opts.makeFileName.empty() ) {
+                writeFile( opts.makeFileName,
+                           generator.generate( BuildFileGenerator::Make, cp3Flags ) );
+                std::fprintf( output, "Written '%s'\n", opts.makeFileName.c_str() );
+            }
+
+            goto End;
+        }
+
+        // Find the classes and methods to make final, if asked to
+        if ( opts.seal ) {
+            buildHierarchy( opts );
+        }
+
+        // Read the sizes of types, for packing fields, and the budgets for classes
+        if ( opts.estimatesLayouts() ) {
+            loadFieldSizes( opts );
+            loadLayoutBudgets( opts );
+        }
+
+        // Process parameters
+        if ( !opts.inputFileNames.empty() ) {
+            std::vector<std::string>::const_iterator it = opts.inputFileNames.begin();
+
+            makeRules.clear();
+            if ( opts.recursive ) {
+                if ( !processRecursively( opts ) ) {
+                    toret = EXIT_FAILURE;
+                }
+            } else {
+                for(; it != opts.inputFileNames.end(); ++it) {
+                    if ( !processFile( *it, opts ) ) {
+                        toret = EXIT_FAILURE;
+                        break;
+                    }
+                }
+            }
+
+            // All dependency rules in a single file
+            if ( toret == EXIT_SUCCESS
+              && !makeRules.empty() )
+            {
+                writeFile( opts.makeDepsFileName, makeRules );
+            }
+        }
+        else throw std::runtime_error( "invalid number of arguments" );
+    }
+    catch(const std::runtime_error &e) {
+        std::fprintf( output, "\nError: '%s'\n", e.what() );
+        toret = EXIT_FAILURE;
+    }
+    catch(const std::exception &e) {
+        std::fprintf( output, "\nCRITICAL: '%s'\n", e.what() );
+        toret = EXIT_FAILURE;
+    }
+
+    End:
+    std::fflush( output );
+    output = oldOutput;
+    return toret;
+}
+
+bool Driver::processFile(const std::string &inputFileName, const Options &opts)
+{
+    std::auto_ptr<Parser::Cp3Parser> parser;
+    std::string contents;
+    std::string sourceName = inputFileName;
+    std::string moduleName;
+    std::string inputPath = inputFileName;
+    bool toret = true;
+
+    // Standard input is named after the module given, if any
+    if ( inputFileName == StdinFileName ) {
+        moduleName = opts.moduleName;
+
+        if ( moduleName.empty() ) {
+            moduleName = StdinModuleName;
+        }
+
+        sourceName = moduleName + AppInfo::Cp3FilesExt;
+        inputPath = StdinPath;
+    }
+
+    try {
+        // Only process it provided it has the correct extension
+        if ( AppInfo::isAcceptedExt( FileMan::getExt( sourceName ) ) )
+        {
+            // Open input file
+            InputFile inputFile( inputPath );
+
+            // Prepare output file names
+            std::string outputHeaderName = getOutputName( opts, sourceName, AppInfo::CHeaderFilesExt );
+            std::string outputImplName   = getOutputName( opts, sourceName, AppInfo::CppFilesExt );
+            std::string outputDepsName   = getOutputName( opts, sourceName, AppInfo::DepFilesExt );
+
+            // Chk if anything really needs to be done
+            if ( !opts.force
+              && !opts.isStreaming()
+              && moduleName.empty() )
+            {
+                bool updated = isUpdated( inputFile, outputHeaderName, outputImplName );
+
+                if ( !updated
+                  && keepWarm
+                  && getTimeStamp( outputHeaderName ) != 0
+                  && getTimeStamp( outputImplName ) != 0
+                  && readFile( inputFileName, contents ) )
+                {
+                    updated = isUnchanged( getWarmKey( inputFileName, outputHeaderName, opts ), contents );
+                }
+
+                if ( updated ) {
+                    std::fprintf( output, "Skipping '%s' due to '%s' and '%s' being up to date.\n\n",
+                                inputFileName.c_str(),
+                                outputHeaderName.c_str(),
+                                outputImplName.c_str()
+                    );
+                    goto End;
+                }
+            }
+
+            // Prepare output, in memory
+            // Line directives go only to the implementation, so the header
+            // does not change when lines are added to the module
+            OutputBuffer outHeader( outputHeaderName );
+            OutputBuffer outImpl( outputImplName );
+
+            outHeader.setLineInfo( false );
+
+            // Process file
+            parser.reset(
+                new Parser::Cp3Parser( inputFile, outHeader, outImpl, opts.strictness, moduleName )
+            );
+
+            if ( !opts.searchPaths.empty() ) {
+                parser->setImportResolver( getImportResolver( opts ), getDirectory( sourceName ) );
+            }
+
+            if ( !opts.outputDir.empty() ) {
+                parser->setSourceDir(
+                    getRelativePath( getDirectory( outputHeaderName ), getDirectory( sourceName ) ) );
+            }
+
+            parser->setDeferImports( opts.moveImports );
+            parser->setPrivateInImpl( opts.privateInImpl );
+
+            if ( opts.inliningPolicy ) {
+                parser->setInliningPolicy( opts.maxStatementsInlined, opts.maxStatementsKeptInline );
+            }
+
+            if ( opts.constexprConstants ) {
+                parser->setConstexprConstants( opts.inlineConstants );
+            }
+
+            parser->setCharArrays( opts.charArrays );
+            parser->setClassHierarchy( opts.seal ? hierarchy.get() : NULL );
+            parser->setFieldSizes( opts.estimatesLayouts() ? fieldSizes.get() : NULL );
+            parser->setPackFields( opts.packFields );
+            parser->setLayoutBudgets( opts.layoutBudgetsFileName.empty() ? NULL : layoutBudgets.get() );
+
+            std::fprintf( output, "Processing( '%s' )...\n", inputFileName.c_str() );
+            parser->process();
+
+            if ( opts.moveImports ) {
+                placeImports( *parser, outImpl, sourceName, opts );
+            }
+
+            if ( opts.inliningPolicy
+              && opts.verbose )
+            {
+                reportPlacements( *parser );
+            }
+
+            if ( opts.reportInitializers ) {
+                reportInitializers( *parser );
+            }
+
+            if ( opts.estimatesLayouts() ) {
+                reportLayouts( *parser );
+            }
+
+            reportWarnings( *parser );
+
+            // Finishing
+            const uint64_t fingerprint = hash( outHeader.getContents() );
+
+            if ( opts.isStreaming() ) {
+                writeStreams( outHeader, outImpl, opts );
+            } else {
+                if ( !opts.outputDir.empty() ) {
+                    makeDirectories( getDirectory( outputHeaderName ) );
+                }
+
+                // Keep the header if its interface did not change
+                std::string oldHeader;
+
+                if ( readFile( outputHeaderName, oldHeader )
+                  && oldHeader == outHeader.getContents() )
+                {
+                    if ( opts.verbose ) {
+                        std::fprintf( output, "Interface of '%s' unchanged.\n", outputHeaderName.c_str() );
+                    }
+                }
+                else outHeader.save();
+
+                outImpl.save();
+
+                if ( opts.useDepDb ) {
+                    DependencyDatabase depDb( opts.depDbFileName );
+                    DependencyDatabase::Record record;
+                    const Tds::Module &module = parser->getModule();
+                    const Tds::Module::Dependencies &deps = module.getDependencies();
+                    const Tds::Module::Dependencies &imports = module.getImports();
+
+                    record.module = getNormalizedFileName( sourceName );
+                    record.interfaceHash = fingerprint;
+                    record.imports = imports;
+
+                    if ( moduleName.empty()
+                      && ( !contents.empty()
+                        || readFile( inputFileName, contents ) ) )
+                    {
+                        record.contentHash = hash( contents );
+                    }
+
+                    for(unsigned int i = 0; i < deps.size(); ++i) {
+                        if ( std::find( imports.begin(), imports.end(), deps[ i ] ) == imports.end() ) {
+                            record.includes.push_back( deps[ i ] );
+                        }
+                    }
+
+                    depDb.append( record );
+                }
+                else saveDependencies( outputDepsName, fingerprint, parser->getModule().getDependencies() );
+
+                if ( opts.trackSymbols ) {
+                    saveSymbols( *parser, outHeader, outImpl, sourceName, opts );
+                }
+            }
+
+            if ( opts.makeDeps ) {
+                std::vector<std::string> targets;
+
+                targets.push_back( outputHeaderName );
+                targets.push_back( outputImplName );
+
+                // The fingerprint goes after the rule, being a comment for make,
+                // and an output not declared in the build file for Ninja (deps = gcc)
+                const std::string rule = parser->getMakeRule( targets )
+                                       + getInterfaceComment( fingerprint );
+
+                if ( opts.makeDepsFileName.empty() ) {
+                    writeFile( getOutputName( opts, sourceName, AppInfo::MakeDepFilesExt ), rule );
+                }
+                else {
+                    Lock lock( mutex );
+                    makeRules += rule;
+                }
+            }
+            std::fprintf( output, "Done( '%s' ).\n", outputImplName.c_str() );
+
+            // Remember it, if needed
+            if ( keepWarm
+              && moduleName.empty()
+              && ( !contents.empty()
+                || readFile( inputFileName, contents ) ) )
+            {
+                const std::string key = getWarmKey( inputFileName, outputHeaderName, opts );
+                Lock lock( mutex );
+
+                warmCache[ key ] = hash( contents );
+            }
+        }
+        else std::fprintf( output, "Skipped( '%s' ).\n", inputFileName.c_str() );
+    } catch(const Parser::ParserError &e) {
+        std::string statement;
+        unsigned int pos = 0;
+
+        if ( parser.get() != NULL
+          && parser->getCurrentLex() != NULL )
+        {
+            statement = parser->getCurrentLine();
+            pos = parser->getCurrentPos();
+        }
+
+        std::fprintf( output, "\n%s: %s at %d,%d\n\t%s\n\t%s:%d: '%s'\n",
+                inputFileName.c_str(),
+                e.getType(),
+                e.getNumLine(),
+                pos,
+                statement.c_str(),
+                inputFileName.c_str(),
+                e.getNumLine(),
+                e.what()
+        );
+
+        toret = false;
+    }
+    catch(const Tds::StrictnessError &e) {
+        std::fprintf( output, "\nStrictness error: '%s'\n", e.what() );
+        toret = false;
+    }
+    catch(const Tds::SemanticError &e) {
+        std::fprintf( output, "\nSemantic error: '%s'\n", e.what() );
+        toret = false;
+    }
+    catch(const std::runtime_error &e) {
+        std::fprintf( output, "\nError: '%s'\n", e.what() );
+        toret = false;
+    }
+    catch(const std::exception &e) {
+        std::fprintf( output, "\nCRITICAL: '%s'\n", e.what() );
+        toret = false;
+    }
+    catch(...) {
+        std::fprintf( output, "\nCRITICAL UNKNOWN ERROR\n" );
+        toret = false;
+    }
+
+    End:
+    return toret;
+}
+
+void Driver::scanDependencies(const Options &opts)
+{
+    std::vector<Parser::ModuleScanner> scanners;
+    std::string deps;
+
+    for(unsigned int i = 0; i < opts.inputFileNames.size(); ++i) {
+        if ( AppInfo::isAcceptedExt( FileMan::getExt( opts.inputFileNames[ i ] ) ) ) {
+            scanners.push_back( Parser::ModuleScanner( opts.inputFileNames[ i ], true ) );
+        }
+    }
+
+    Parser::ModuleScanner::scanAll( scanners, opts.numJobs );
+
+    // One line per module: module: headers...
+    for(unsigned int i = 0; i < scanners.size(); ++i) {
+        const Parser::ModuleScanner::Headers headers = scanners[ i ].getDependencies();
+
+        deps += Parser::Cp3Parser::escapeForMake( scanners[ i ].getFileName() ) + ':';
+
+        for(unsigned int j = 0; j < headers.size(); ++j) {
+            deps += ' ';
+            deps += Parser::Cp3Parser::escapeForMake( headers[ j ] );
+        }
+
+        deps += '\n';
+    }
+
+    if ( opts.scanDepsFileName.empty() ) {
+        if ( !Protocol::writeAll( STDOUT_FILENO, deps ) ) {
+            throw std::runtime_error( "unable to write dependencies" );
+        }
+    }
+    else writeFile( opts.scanDepsFileName, deps );
+
+    if ( opts.verbose ) {
+        std::fprintf( output, "Scanned %u module(s).\n", (unsigned int) scanners.size() );
+    }
+}
+
+void Driver::queryAffected(const Options &opts)
+{
+    ReverseIndex index( opts.indexFileName );
+    std::vector<uint32_t> affected;
+    std::vector<std::string> missing;
+    std::string result;
+
+    index.getAffected( opts.inputFileNames, affected, missing );
+
+    // One line per module: module<tab>header
+    for(unsigned int i = 0; i < affected.size(); ++i) {
+        result += index.getModuleName( affected[ i ] );
+        result += '\t';
+        result += index.getHeaderName( affected[ i ] );
+        result += '\n';
+    }
+
+    // Modules not in the index are new, or the index is stale:
+    // they are affected, at least, though their importers are unknown
+    for(unsigned int i = 0; i < missing.size(); ++i) {
+        std::fprintf( output, "Warning: '%s' is not in '%s', which may be stale\n",
+                      missing[ i ].c_str(), opts.indexFileName.c_str() );
+
+        result += missing[ i ];
+        result += '\t';
+        result += getOutputName( opts, missing[ i ], AppInfo::CHeaderFilesExt );
+        result += '\n';
+    }
+
+    if ( !Protocol::writeAll( STDOUT_FILENO, result ) ) {
+        throw std::runtime_error( "unable to write affected modules" );
+    }
+
+    if ( opts.verbose ) {
+        std::fprintf( output, "%u module(s) affected, out of %u.\n",
+                      (unsigned int) ( affected.size() + missing.size() ),
+                      (unsigned int) index.getNumModules() );
+    }
+}
+
+void Driver::exportDependencies(const Options &opts)
+{
+    DependencyDatabase depDb( opts.depDbFileName );
+    DependencyDatabase::Records records;
+
+    depDb.compact( true );
+    depDb.load( records );
+
+    for(DependencyDatabase::Records::const_iterator it = records.begin(); it != records.end(); ++it)
+    {
+        const DependencyDatabase::Record &record = it->second;
+        std::vector<std::string> deps = record.imports;
+
+        deps.insert( deps.end(), record.includes.begin(), record.includes.end() );
+
+        if ( !opts.outputDir.empty() ) {
+            makeDirectories( getDirectory( getOutputName( opts, record.module, AppInfo::DepFilesExt ) ) );
+        }
+
+        saveDependencies( getOutputName( opts, record.module, AppInfo::DepFilesExt ),
+                          record.interfaceHash, deps );
+    }
+
+    std::fprintf( output, "Exported the dependencies of %u module(s).\n", (unsigned int) records.size() );
+}
+
+void Driver::saveSymbols(const Parser::Cp3Parser &parser, const OutputBuffer &outHeader,
+                         const OutputBuffer &outImpl, const std::string &sourceName, const Options &opts)
+{
+    const Tds::Module &module = parser.getModule();
+    const Tds::Module::Dependencies &imports = module.getImports();
+    SymbolFile symbols( getOutputName( opts, sourceName, AppInfo::SymFilesExt ) );
+
+    symbols.addExports( module );
+
+    symbols.collectUses( outHeader.getContents() );
+    symbols.collectUses( outImpl.getContents() );
+
+    // Store the current hashes of the symbols used, as the imported modules export them
+    for(unsigned int i = 0; i < imports.size(); ++i) {
+        std::string importName;
+
+        if ( !imports[ i ].empty()
+          && imports[ i ][ 0 ] == '/' )
+        {
+            importName = FileMan::replaceExt( imports[ i ], AppInfo::SymFilesExt );
+        }
+        else importName = getOutputName( opts, getDirectory( sourceName ) + imports[ i ], AppInfo::SymFilesExt );
+
+        SymbolFile imported( importName );
+
+        if ( !imported.load()
+          && opts.verbose )
+        {
+            std::fprintf( output, "No symbols for '%s' yet.\n", importName.c_str() );
+        }
+
+        symbols.addImport( imported );
+    }
+
+    symbols.save();
+}
+
+void Driver::checkSymbols(const Options &opts)
+{
+    std::string result;
+    std::string reason;
+
+    // One line per module to recompile
+    for(unsigned int i = 0; i < opts.inputFileNames.size(); ++i) {
+        const std::string &module = opts.inputFileNames[ i ];
+        SymbolFile symbols( getOutputName( opts, module, AppInfo::SymFilesExt ) );
+        bool isStale = true;
+
+        if ( symbols.load() )
+                isStale = symbols.isStale( reason );
+        else    reason = symbols.getFileName();
+
+        if ( isStale ) {
+            result += module + '\n';
+
+            if ( opts.verbose ) {
+                std::fprintf( output, "'%s' is stale due to '%s'.\n", module.c_str(), reason.c_str() );
+            }
+        }
+    }
+
+    if ( !Protocol::writeAll( STDOUT_FILENO, result ) ) {
+        throw std::runtime_error( "unable to write stale modules" );
+    }
+}
+
+bool Driver::getImportedInterface(const Options &opts, const std::string &sourceName,
+                                  const std::string &header, SymbolFile &symbols)
+{
+    std::string source;
+    bool toret = false;
+
+    if ( getImportResolver( opts )->findModule( header, getDirectory( sourceName ), source ) ) {
+        const time_t timeStamp = getTimeStamp( source );
+
+        // Look for it among the ones already parsed
+        {
+            Lock lock( mutex );
+            Interfaces::const_iterator it = interfaces.find( source );
+
+            if ( it != interfaces.end()
+              && it->second.first == timeStamp )
+            {
+                symbols = it->second.second;
+                toret = true;
+            }
+        }
+
+        // Parse it, discarding the output
+        if ( !toret ) {
+            try {
+                InputFile inputFile( source );
+                OutputBuffer outHeader( getOutputName( opts, source, AppInfo::CHeaderFilesExt ) );
+                OutputBuffer outImpl( getOutputName( opts, source, AppInfo::CppFilesExt ) );
+                Parser::Cp3Parser parser( inputFile, outHeader, outImpl, opts.strictness );
+
+                parser.process();
+                symbols = SymbolFile( getOutputName( opts, source, AppInfo::SymFilesExt ) );
+                symbols.addExports( parser.getModule() );
+
+                Lock lock( mutex );
+                interfaces.erase( source );
+                interfaces.insert( Interfaces::value_type( source, std::make_pair( timeStamp, symbols ) ) );
+                toret = true;
+            }
+            catch(const std::exception &e) {
+                if ( opts.verbose ) {
+                    std::fprintf( output, "Unable to read the interface of '%s': %s\n",
+                                  source.c_str(), e.what() );
+                }
+            }
+        }
+    }
+
+    return toret;
+}
+
+void Driver::placeImports(Parser::Cp3Parser &parser, const OutputBuffer &outImpl,
+                          const std::string &sourceName, const Options &opts)
+{
+    Parser::Cp3Parser::DeferredImports &imports = parser.getDeferredImports();
+
+    for(unsigned int i = 0; i < imports.size(); ++i) {
+        Parser::Cp3Parser::DeferredImport &import = imports[ i ];
+        SymbolFile symbols( import.header );
+        SymbolFile::Usage usage;
+
+        if ( !getImportedInterface( opts, sourceName, import.header, symbols ) ) {
+            continue;
+        }
+
+        symbols.findUsage( parser.getModule(), outImpl.getContents(), usage );
+
+        if ( !usage.isUsedInHeader() ) {
+            import.inHeader = false;
+        }
+        else
+        if ( opts.forwardDeclarations
+          && usage.needed.empty() )
+        {
+            import.inHeader = false;
+            import.classes.assign( usage.forwardDeclarable.begin(), usage.forwardDeclarable.end() );
+        }
+
+        // Report where it is used
+        if ( opts.verbose ) {
+            std::string places;
+
+            places += usage.inDeclarations ? " declarations" : "";
+            places += usage.inData ?         " data" : "";
+            places += usage.inSignatures ?   " signatures" : "";
+            places += usage.inInlineCode ?   " inline-code" : "";
+            places += usage.inBodies ?       " bodies" : "";
+
+            std::fprintf( output, "'%s' used in:%s -> %s, %u class(es) forward declared.\n",
+                          import.header.c_str(),
+                          places.empty() ? " nothing" : places.c_str(),
+                          import.inHeader ? "header" : "implementation",
+                          (unsigned int) import.classes.size() );
+        }
+    }
+
+    parser.writeDeferredImports();
+}
+
+void Driver::reportPlacements(const Parser::Cp3Parser &parser)
+{
+    const Parser::Cp3Parser::Placements &placements = parser.getPlacements();
+
+    for(unsigned int i = 0; i < placements.size(); ++i) {
+        const Parser::Cp3Parser::Placement &placement = placements[ i ];
+
+        std::fprintf( output, "'%s' (line %u, %u statement(s)) -> %s%s.\n",
+                      placement.name.c_str(),
+                      placement.line,
+                      placement.statements,
+                      placement.inHeader ? "header" : "implementation",
+                      placement.changed ? ", moved" : "" );
+    }
+}
+
+void Driver::reportInitializers(const Parser::Cp3Parser &parser)
+{
+    const Parser::Cp3Parser::DynamicInitializers &initializers = parser.getDynamicInitializers();
+
+    for(unsigned int i = 0; i < initializers.size(); ++i) {
+        const Parser::Cp3Parser::DynamicInitializer &initializer = initializers[ i ];
+
+        std::fprintf( output, "'%s' (line %u) initialized at startup: %s.\n",
+                      initializer.name.c_str(),
+                      initializer.line,
+                      initializer.cost.c_str() );
+    }
+
+    std::fprintf( output, "%u dynamic initializer(s).\n", (unsigned int) initializers.size() );
+}
+
+void Driver::buildHierarchy(const Options &opts)
+{
+    hierarchy.reset( new ClassHierarchy() );
+
+    // Parse all modules, discarding the output
+    for(unsigned int i = 0; i < opts.inputFileNames.size(); ++i) {
+        const std::string &source = opts.inputFileNames[ i ];
+
+        if ( !AppInfo::isAcceptedExt( FileMan::getExt( source ) ) ) {
+            continue;
+        }
+
+        try {
+            InputFile inputFile( source );
+            OutputBuffer outHeader( getOutputName( opts, source, AppInfo::CHeaderFilesExt ) );
+            OutputBuffer outImpl( getOutputName( opts, source, AppInfo::CppFilesExt ) );
+            Parser::Cp3Parser parser( inputFile, outHeader, outImpl, opts.strictness );
+
+            parser.process();
+            hierarchy->addModule( parser.getModule() );
+        }
+        catch(const std::exception &e) {
+            throw std::runtime_error( "unable to read the classes of '" + source + "': " + e.what() );
+        }
+    }
+
+    for(unsigned int i = 0; i < opts.sealExcluded.size(); ++i) {
+        hierarchy->exclude( opts.sealExcluded[ i ] );
+    }
+
+    hierarchy->seal();
+
+    // Report what was sealed
+    const ClassHierarchy::Names &classes = hierarchy->getSealedClasses();
+    const ClassHierarchy::Names &methods = hierarchy->getSealedMethods();
+
+    for(ClassHierarchy::Names::const_iterator it = classes.begin(); it != classes.end(); ++it) {
+        std::fprintf( output, "Sealed class '%s'.\n", it->c_str() );
+    }
+
+    for(ClassHierarchy::Names::const_iterator it = methods.begin(); it != methods.end(); ++it) {
+        std::fprintf( output, "Sealed method '%s'.\n", it->c_str() );
+    }
+
+    std::fprintf( output, "%u class(es) and %u method(s) sealed.\n\n",
+                  (unsigned int) classes.size(), (unsigned int) methods.size() );
+}
+
+void Driver::loadFieldSizes(const Options &opts)
+{
+    std::string contents;
+
+    fieldSizes.reset( new FieldSizes() );
+
+    if ( !opts.fieldSizesFileName.empty() ) {
+        if ( !readFile( opts.fieldSizesFileName, contents ) ) {
+            throw std::runtime_error( "unable to read the sizes of types in '"
+                                      + opts.fieldSizesFileName + '\'' );
+        }
+
+        try {
+            fieldSizes->parse( contents );
+        }
+        catch(const std::runtime_error &e) {
+            throw std::runtime_error( opts.fieldSizesFileName + ": " + e.what() );
+        }
+    }
+}
+
+void Driver::loadLayoutBudgets(const Options &opts)
+{
+    std::string contents;
+
+    layoutBudgets.reset( new LayoutBudgets() );
+
+    if ( !opts.layoutBudgetsFileName.empty() ) {
+        if ( !readFile( opts.layoutBudgetsFileName, contents ) ) {
+            throw std::runtime_error( "unable to read the budgets for classes in '"
+                                      + opts.layoutBudgetsFileName + '\'' );
+        }
+
+        try {
+            layoutBudgets->parse( contents, opts.layoutBudgetsFileName );
+        }
+        catch(const std::runtime_error &e) {
+            throw std::runtime_error( opts.layoutBudgetsFileName + ": " + e.what() );
+        }
+    }
+}
+
+void Driver::reportWarnings(const Parser::Cp3Parser &parser)
+{
+    const Parser::Cp3Parser::Warnings &warnings = parser.getWarnings();
+
+    for(unsigned int i = 0; i < warnings.size(); ++i) {
+        std::fprintf( output, "Warning: %s\n", warnings[ i ].c_str() );
+    }
+}
+
+void Driver::reportLayouts(const Parser::Cp3Parser &parser)
+{
+    const Parser::Cp3Parser::ClassLayouts &layouts = parser.getClassLayouts();
+
+    for(unsigned int i = 0; i < layouts.size(); ++i) {
+        const Parser::Cp3Parser::ClassLayout &layout = layouts[ i ];
+
+        if ( layout.packed ) {
+            std::fprintf( output, "Class '%s': fields packed, estimated size %u -> %u byte(s)",
+                          layout.name.c_str(),
+                          layout.sizeBefore,
+                          layout.sizeAfter );
+        }
+        else
+        if ( !layout.dependency.empty() ) {
+            std::fprintf( output, "Class '%s': fields not packed, as %s, estimated size %u byte(s)",
+                          layout.name.c_str(),
+                          layout.dependency.c_str(),
+                          layout.sizeAfter );
+        } else {
+            std::fprintf( output, "Class '%s': estimated size %u byte(s)",
+                          layout.name.c_str(),
+                          layout.sizeAfter );
+        }
+
+        if ( layout.budget > 0 ) {
+            std::fprintf( output, ", budget %u (%+d)",
+                          layout.budget,
+                          (int) layout.sizeAfter - (int) layout.budget );
+        }
+
+        if ( !layout.unknownTypes.empty() ) {
+            std::fprintf( output, " (assuming %u for %s)", FieldSizes::PointerSize, layout.unknownTypes.c_str() );
+        }
+
+        std::fprintf( output, ".\n" );
+    }
+}
+
+void Driver::writeStreams(const OutputBuffer &outHeader, const OutputBuffer &outImpl, const Options &opts)
+{
+    if ( opts.headerFd >= 0 ) {
+        outHeader.save( opts.headerFd );
+    }
+
+    if ( opts.implFd >= 0 ) {
+        // Both in the same stream: the implementation needs no #include of the header
+        if ( opts.implFd == opts.headerFd ) {
+            const std::string &impl = outImpl.getContents();
+            const std::string include = "#include \""
+                                      + FileMan::getFileName( outHeader.getFileName() )
+                                      + "\"\n";
+            OutputBuffer body( outImpl.getFileName() );
+
+            if ( impl.compare( 0, include.length(), include ) == 0 ) {
+                body.write( impl.substr( include.length() ) );
+            }
+            else body.write( impl );
+
+            body.save( opts.implFd );
+        }
+        else outImpl.save( opts.implFd );
+    }
+}
+
+std::string Driver::getWarmKey(const std::string &inputFileName,
+                               const std::string &outputHeaderName,
+                               const Options &opts)
+{
+    return getAbsoluteFileName( inputFileName ) + '\n'
+         + getAbsoluteFileName( outputHeaderName ) + '\n'
+         + opts.getSignature();
+}
+
+bool Driver::isUnchanged(const std::string &key, const std::string &contents) const
+{
+    Lock lock( mutex );
+    bool toret = false;
+    WarmCache::const_iterator it = warmCache.find( key );
+
+    if ( it != warmCache.end() ) {
+        toret = ( it->second == hash( contents ) );
+    }
+
+    return toret;
+}
+
+uint64_t Driver::hash(const std::string &contents)
+{
+    uint64_t toret = 14695981039346656037ULL;
+    std::string::const_iterator it = contents.begin();
+
+    for(; it != contents.end(); ++it) {
+        toret ^= (unsigned char) *it;
+        toret *= 1099511628211ULL;
+    }
+
+    return toret;
+}
+
+std::string Driver::getInterfaceComment(uint64_t fingerprint)
+{
+    char buffer[ 17 ];
+
+    std::sprintf( buffer, "%016llx", (unsigned long long) fingerprint );
+    return InterfaceComment + buffer + '\n';
+}
+
+bool Driver::readFile(const std::string &fileName, std::string &contents)
+{
+    bool toret = false;
+    FILE * f = std::fopen( fileName.c_str(), "rb" );
+
+    contents.clear();
+
+    if ( f != NULL ) {
+        char buffer[ 8192 ];
+        size_t numRead;
+
+        while( ( numRead = std::fread( buffer, 1, sizeof( buffer ), f ) ) > 0 ) {
+            contents.append( buffer, numRead );
+        }
+
+        toret = ( std::ferror( f ) == 0 );
+        std::fclose( f );
+    }
+
+    return toret;
+}
+
+std::string Driver::getOutputName(const Options &opts, const std::string &sourceName, const std::string &ext)
+{
+    std::string toret = FileMan::replaceExt( sourceName, ext );
+
+    if ( !opts.outputDir.empty() ) {
+        // Mirror the path of the module, with ".." going to "__"
+        const std::vector<std::string> components = splitPath( toret );
+
+        toret = opts.outputDir;
+        for(unsigned int i = 0; i < components.size(); ++i) {
+            if ( toret[ toret.length() - 1 ] != '/' ) {
+                toret += '/';
+            }
+
+            if ( components[ i ] == ".." )
+                    toret += "__";
+            else    toret += components[ i ];
+        }
+    }
+
+    return toret;
+}
+
+std::string Driver::getAbsoluteFileName(const std::string &fileName)
+{
+    const std::vector<std::string> components = getAbsolutePath( fileName );
+    std::string toret;
+
+    for(unsigned int i = 0; i < components.size(); ++i) {
+        toret += '/' + components[ i ];
+    }
+
+    if ( toret.empty() ) {
+        toret = "/";
+    }
+
+    return toret;
+}
+
+std::string Driver::getDirectory(const std::string &path)
+{
+    std::string::size_type pos = path.rfind( '/' );
+    std::string toret;
+
+    if ( pos != std::string::npos ) {
+        toret = path.substr( 0, pos + 1 );
+    }
+
+    return toret;
+}
+
+std::string Driver::getNormalizedFileName(const std::string &fileName)
+{
+    return getRelativePath( ".", getDirectory( fileName ) ) + FileMan::getFileName( fileName );
+}
+
+std::string Driver::getRelativePath(const std::string &fromDir, const std::string &toDir)
+{
+    const std::vector<std::string> from = getAbsolutePath( fromDir );
+    const std::vector<std::string> to = getAbsolutePath( toDir );
+    unsigned int common = 0;
+    std::string toret;
+
+    while( common < from.size()
+        && common < to.size()
+        && from[ common ] == to[ common ] )
+    {
+        ++common;
+    }
+
+    for(unsigned int i = common; i < from.size(); ++i) {
+        toret += "../";
+    }
+
+    for(unsigned int i = common; i < to.size(); ++i) {
+        toret += to[ i ] + '/';
+    }
+
+    return toret;
+}
+
+void Driver::makeDirectories(const std::string &dir)
+{
+    std::string::size_type pos = 0;
+
+    while( pos != std::string::npos ) {
+        pos = dir.find( '/', pos + 1 );
+
+        const std::string path = dir.substr( 0, pos );
+
+        if ( !path.empty()
+          && mkdir( path.c_str(), 0777 ) != 0
+          && errno != EEXIST )
+        {
+            throw std::runtime_error( "unable to create directory '" + path + '\'' );
+        }
+    }
+}
+
+void Driver::writeFile(const std::string &fileName, const std::string &contents)
+{
+    OutputFile file( fileName );
+
+    if ( file.isOpen() ) {
+        file.write( contents );
+        file.close();
+    }
+    else throw std::runtime_error( "unable to create '" + fileName + "' file" );
+}
+
+time_t Driver::getTimeStamp(const std::string &fileName)
+{
+    struct stat info;
+    time_t toret = 0;
+
+    if ( stat( fileName.c_str(), &info ) == 0 ) {
+        toret = info.st_mtime;
+    }
+
+    return toret;
+}
+
+}
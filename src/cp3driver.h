@@ -0,0 +1,367 @@
+#ifndef CP3DRIVER_H_INCLUDED
+#define CP3DRIVER_H_INCLUDED
+
+#include "cp3tds.h"
+#include "cp3output.h"
+#include "cp3symbols.h"
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <pthread.h>
+
+namespace Cp3mm {
+
+class ImportResolver;
+class ClassHierarchy;
+class FieldSizes;
+class LayoutBudgets;
+
+namespace Parser {
+    class Cp3Parser;
+}
+
+/// The options given in the command line
+class Options {
+public:
+    /// The default maximum number of statements of code moved to the header
+    static const unsigned int DefaultMaxStatementsInlined;
+
+    /// The default maximum number of statements of inline code kept in the header
+    static const unsigned int DefaultMaxStatementsKeptInline;
+
+    /// Generate files ignoring the timestamp check
+    bool force;
+
+    /// Show help and exit
+    bool help;
+
+    /// Show version and exit
+    bool version;
+
+    /// Show additional information while processing
+    bool verbose;
+
+    /// Run as a daemon, listening for requests on a local socket
+    bool server;
+
+    /// The path of the local socket for the server
+    std::string socketPath;
+
+    /// Watch directories, regenerating modules as they change
+    bool watch;
+
+    /// Write a Makefile-syntax dependency file (-MD)
+    bool makeDeps;
+
+    /// The name of the Makefile-syntax dependency file (-MF), X.d if empty
+    std::string makeDepsFileName;
+
+    /// The name of the Ninja build file to write for the modules, if any
+    std::string ninjaFileName;
+
+    /// The name of the make build file to write for the modules, if any
+    std::string makeFileName;
+
+    /// The directory for generated files, mirroring the paths of modules.
+    /// Generated files are written next to the modules if empty.
+    std::string outputDir;
+
+    /// Also generate the imported modules (and included .cp3 files), when out of date
+    bool recursive;
+
+    /// The directories to look for imported modules in (-I), after the one of the module
+    std::vector<std::string> searchPaths;
+
+    /// Write the generated header and implementation to standard output
+    bool toStdout;
+
+    /// The file descriptor to write the generated header to, -1 for a file
+    int headerFd;
+
+    /// The file descriptor to write the generated implementation to, -1 for a file
+    int implFd;
+
+    /// The name of the module read from standard input ("-")
+    std::string moduleName;
+
+    /// Only scan the modules for their dependencies, as fast as possible
+    bool scanDeps;
+
+    /// The file in which to write the dependencies found, stdout if empty
+    std::string scanDepsFileName;
+
+    /// The number of threads to use, as many as processors if 0
+    unsigned int numJobs;
+
+    /// Build the reverse index of imports for the given modules
+    bool buildIndex;
+
+    /// List the modules affected by changes in the given modules, using the index
+    bool queryIndex;
+
+    /// The name of the reverse index file
+    std::string indexFileName;
+
+    /// Store dependencies in a single database, instead of a .dep file per module
+    bool useDepDb;
+
+    /// Write the .dep file of each module in the database
+    bool exportDepDb;
+
+    /// The name of the dependency database
+    std::string depDbFileName;
+
+    /// Write the symbols exported and used by each module (.sym)
+    bool trackSymbols;
+
+    /// List the modules using symbols that changed in the modules they import
+    bool checkSymbols;
+
+    /// Declare private namespace members and classes in the implementation, not in the header
+    bool privateInImpl;
+
+    /// Include the imported modules not used in the header only in the implementation
+    bool moveImports;
+
+    /// Forward declare the classes of imported modules in the header, when enough,
+    /// including the imported modules only in the implementation
+    bool forwardDeclarations;
+
+    /// Place code in the header or in the implementation depending on its size and shape
+    bool inliningPolicy;
+
+    /// The maximum number of statements of code moved to the header
+    unsigned int maxStatementsInlined;
+
+    /// The maximum number of statements of inline code kept in the header
+    unsigned int maxStatementsKeptInline;
+
+    /// Define the constants initialized with constant expressions as constexpr in the header
+    bool constexprConstants;
+
+    /// Define the constexpr constants as inline variables (C++17)
+    bool inlineConstants;
+
+    /// Store std::string statics initialized with string literals as const char arrays
+    bool charArrays;
+
+    /// List the data initialized at startup, running code
+    bool reportInitializers;
+
+    /// Make final the classes with no subclasses among the modules given,
+    /// and the virtual methods not overridden
+    bool seal;
+
+    /// The classes, or namespaces, not to make final
+    std::vector<std::string> sealExcluded;
+
+    /// Write the private and protected fields of classes sorted by alignment
+    bool packFields;
+
+    /// The name of the table of sizes of the types of the project, if any
+    std::string fieldSizesFileName;
+
+    /// The name of the table of budgets for the layout of classes, if any
+    std::string layoutBudgetsFileName;
+
+    /// Determines whether the layout of classes is estimated
+    bool estimatesLayouts() const
+        { return ( packFields || !layoutBudgetsFileName.empty() ); }
+
+    /// Strictness level of the preprocessor
+    Tds::Entity::Strictness strictness;
+
+    /// The input files to process (directories, when watching)
+    std::vector<std::string> inputFileNames;
+
+    Options()
+        : force( false ), help( false ), version( false ), verbose( false ),
+          server( false ), watch( false ), makeDeps( false ), recursive( false ),
+          toStdout( false ), headerFd( -1 ), implFd( -1 ),
+          scanDeps( false ), numJobs( 0 ), buildIndex( false ), queryIndex( false ),
+          useDepDb( false ), exportDepDb( false ), trackSymbols( false ), checkSymbols( false ),
+          privateInImpl( false ), moveImports( false ), forwardDeclarations( false ),
+          inliningPolicy( false ), maxStatementsInlined( DefaultMaxStatementsInlined ),
+          maxStatementsKeptInline( DefaultMaxStatementsKeptInline ),
+          constexprConstants( false ), inlineConstants( false ),
+          charArrays( false ), reportInitializers( false ), seal( false ),
+          packFields( false ), strictness( Tds::Entity::MediumStrictness )
+        {}
+
+    /// Reads the options in the command line, storing the remaining arguments as file names
+    /// @param argc The number of arguments
+    /// @param argv The arguments themselves, argv[ 0 ] being the program name
+    void process(int argc, const char * argv[]);
+
+    /// Determines whether generated files are written to descriptors instead of files
+    bool isStreaming() const
+        { return ( headerFd >= 0 || implFd >= 0 ); }
+
+    /// Returns the options affecting the generated files, as text,
+    /// along with the directory relative file names are relative to,
+    /// so files generated with different options can be told apart
+    std::string getSignature() const;
+
+    /// Determines whether results (not messages) are written to standard output
+    bool usesStdout() const
+        { return ( isStreaming() || queryIndex || checkSymbols || ( scanDeps && scanDepsFileName.empty() ) ); }
+};
+
+/**
+    The driver takes a set of options and processes the given modules,
+    producing their header, implementation and dependency files.
+    It is shared by the command line and the server, so both produce the same results.
+    Modules can be processed from several threads at the same time.
+    All messages are written to the output stream given (stdout by default).
+*/
+class Driver {
+public:
+    /// Creates a new driver
+    /// @param out The stream to write messages to
+    Driver(FILE * out = stdout);
+
+    ~Driver();
+
+    /// The file name standing for standard input
+    static const std::string StdinFileName;
+
+    /// Runs a full command line: options and files
+    /// @param argc The number of arguments
+    /// @param argv The arguments themselves, argv[ 0 ] being the program name
+    /// @return EXIT_SUCCESS or EXIT_FAILURE
+    int run(int argc, const char * argv[]);
+
+    /// Processes a single module, generating its output files
+    /// @param inputFileName The name of the module source file
+    /// @param opts The options to apply
+    /// @return true if everything went fine, false otherwise
+    bool processFile(const std::string &inputFileName, const Options &opts);
+
+    /// Returns the stream messages are written to
+    FILE * getOutput() const
+        { return output; }
+
+    /// Changes the stream messages are written to
+    /// @param out The new stream
+    void setOutput(FILE * out)
+        { output = out; }
+
+    /// Remember the contents of generated modules between runs,
+    /// so modules that are touched but not modified are not generated again.
+    /// @param v true to remember them, false otherwise
+    void setKeepWarm(bool v = true)
+        { keepWarm = v; }
+
+    /// Forgets the contents of directories read to find imported modules,
+    /// since modules may have been created or deleted
+    void forgetImports();
+
+    /// Computes a hash (FNV-1a, 64 bits) of the given contents
+    /// @param contents The string to compute the hash of
+    /// @return The hash, as a 64 bits unsigned integer
+    static uint64_t hash(const std::string &contents);
+
+    /// Returns the comment recording the fingerprint of the interface of a module
+    /// (the hash of its header) in dependency files, ended by a new line
+    /// @param fingerprint The fingerprint of the interface
+    static std::string getInterfaceComment(uint64_t fingerprint);
+
+    /// Reads a whole file into a string
+    /// @param fileName The name of the file to read
+    /// @param contents The string in which to store the file contents
+    /// @return true if the file could be read, false otherwise
+    static bool readFile(const std::string &fileName, std::string &contents);
+
+    /// Returns the modification time of a file, or 0 if it does not exist
+    static time_t getTimeStamp(const std::string &fileName);
+
+    /// Returns the name of a file generated for a module,
+    /// taking into account the output directory, if any
+    /// @param opts The options, holding the output directory
+    /// @param sourceName The file name of the module
+    /// @param ext The extension of the generated file
+    static std::string getOutputName(const Options &opts, const std::string &sourceName, const std::string &ext);
+
+    /// Returns the directory of a path, ended in '/', or an empty string if it has none
+    static std::string getDirectory(const std::string &path);
+
+    /// Returns the absolute path of a file, with "." and ".." resolved
+    static std::string getAbsoluteFileName(const std::string &fileName);
+
+    /// Returns the name of a file relative to the current directory, with "." and ".." resolved,
+    /// so the same file is always given the same name
+    static std::string getNormalizedFileName(const std::string &fileName);
+
+    /// Returns the path leading from a directory to another one
+    /// @param fromDir The directory the path starts at
+    /// @param toDir The directory the path leads to
+    /// @return The relative path, ending in '/', or empty if both are the same
+    static std::string getRelativePath(const std::string &fromDir, const std::string &toDir);
+
+    /// Creates all the directories in a path, as mkdir -p
+    /// @param dir The path of the directory
+    /// @throw std::runtime_error if a directory cannot be created
+    static void makeDirectories(const std::string &dir);
+
+    /// Writes a whole file
+    /// @param fileName The name of the file to write
+    /// @param contents The contents of the file
+    /// @throw std::runtime_error if the file cannot be created
+    static void writeFile(const std::string &fileName, const std::string &contents);
+
+private:
+    /// The hash of the contents of each generated module, by the key given by getWarmKey()
+    typedef std::map<std::string, uint64_t> WarmCache;
+
+    /// The symbols of imported modules, with the timestamp of their source, by file name
+    typedef std::map<std::string, std::pair<time_t, SymbolFile> > Interfaces;
+
+    /// Returns the key of a module in the warm cache: the absolute names of its source
+    /// and header, and the options, as the server is run from different directories
+    static std::string getWarmKey(const std::string &inputFileName,
+                                  const std::string &outputHeaderName,
+                                  const Options &opts);
+    bool isUnchanged(const std::string &key, const std::string &contents) const;
+    void scanDependencies(const Options &opts);
+    bool processRecursively(const Options &opts);
+    void queryAffected(const Options &opts);
+    void exportDependencies(const Options &opts);
+    void saveSymbols(const Parser::Cp3Parser &parser, const OutputBuffer &outHeader,
+                     const OutputBuffer &outImpl, const std::string &sourceName, const Options &opts);
+    void checkSymbols(const Options &opts);
+    bool getImportedInterface(const Options &opts, const std::string &sourceName,
+                              const std::string &header, SymbolFile &symbols);
+    void placeImports(Parser::Cp3Parser &parser, const OutputBuffer &outImpl,
+                      const std::string &sourceName, const Options &opts);
+    void reportPlacements(const Parser::Cp3Parser &parser);
+    void reportInitializers(const Parser::Cp3Parser &parser);
+    void buildHierarchy(const Options &opts);
+    void loadFieldSizes(const Options &opts);
+    void loadLayoutBudgets(const Options &opts);
+    void reportLayouts(const Parser::Cp3Parser &parser);
+    void reportWarnings(const Parser::Cp3Parser &parser);
+    ImportResolver * getImportResolver(const Options &opts);
+    static void writeStreams(const OutputBuffer &outHeader, const OutputBuffer &outImpl, const Options &opts);
+
+    FILE * output;
+    bool keepWarm;
+    WarmCache warmCache;
+    std::string makeRules;
+    std::auto_ptr<ImportResolver> resolver;
+    std::auto_ptr<ClassHierarchy> hierarchy;
+    std::auto_ptr<FieldSizes> fieldSizes;
+    std::auto_ptr<LayoutBudgets> layoutBudgets;
+    Interfaces interfaces;
+
+    /// Protects the state shared when generating modules in parallel
+    mutable pthread_mutex_t mutex;
+};
+
+}
+
+#endif // CP3DRIVER_H_INCLUDED
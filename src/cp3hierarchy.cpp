@@ -0,0 +1,148 @@
+// cp3hierarchy.cpp
+/*
+    Implementation of the hierarchy of classes, for sealing them
+*/
+
+#include "cp3hierarchy.h"
+
+namespace Cp3mm {
+
+void ClassHierarchy::addModule(const Tds::Module &module)
+{
+    const Tds::Module::Classes &moduleClasses = module.getClasses();
+
+    for(Tds::Module::Classes::const_iterator it = moduleClasses.begin(); it != moduleClasses.end(); ++it) {
+        classes[ it->first ] = it->second;
+    }
+}
+
+void ClassHierarchy::resolve(const std::string &scope, const std::string &parentName, Names &parents) const
+{
+    const std::string &access = Tds::Member::AccessOperator;
+    const std::string suffix = access + parentName;
+    std::string prefix = scope;
+
+    // Look for it in the scope, and in each of the enclosing ones
+    for(;;) {
+        const std::string candidate = prefix.empty() ? parentName : prefix + access + parentName;
+
+        if ( classes.find( candidate ) != classes.end() ) {
+            parents.insert( candidate );
+            break;
+        }
+
+        if ( prefix.empty() ) {
+            break;
+        }
+
+        std::string::size_type pos = prefix.rfind( access );
+
+        if ( pos == std::string::npos )
+                prefix.clear();
+        else    prefix.erase( pos );
+    }
+
+    // Otherwise, take any class with that name
+    if ( parents.empty() ) {
+        for(Tds::Module::Classes::const_iterator it = classes.begin(); it != classes.end(); ++it) {
+            if ( it->first.length() > suffix.length()
+              && it->first.compare( it->first.length() - suffix.length(), suffix.length(), suffix ) == 0 )
+            {
+                parents.insert( it->first );
+            }
+        }
+    }
+}
+
+bool ClassHierarchy::isExcluded(const std::string &className) const
+{
+    const std::string &access = Tds::Member::AccessOperator;
+    bool toret = ( excluded.find( className ) != excluded.end() );
+
+    // Maybe the namespace (or class) it is inside of is excluded
+    for(std::string::size_type pos = className.find( access );
+        !toret && pos != std::string::npos;
+        pos = className.find( access, pos + access.length() ))
+    {
+        toret = ( excluded.find( className.substr( 0, pos ) ) != excluded.end() );
+    }
+
+    return toret;
+}
+
+bool ClassHierarchy::isOverridden(const std::string &className, const std::string &name) const
+{
+    std::map<std::string, Names>::const_iterator itSubclasses = subclasses.find( className );
+    bool toret = false;
+
+    if ( itSubclasses != subclasses.end() ) {
+        const Names &children = itSubclasses->second;
+
+        for(Names::const_iterator it = children.begin(); !toret && it != children.end(); ++it) {
+            const Tds::Module::ClassInfo &info = classes.find( *it )->second;
+
+            toret = ( info.methods.find( name ) != info.methods.end()
+                   || isOverridden( *it, name ) );
+        }
+    }
+
+    return toret;
+}
+
+const ClassHierarchy::Names &ClassHierarchy::getSubclasses(const std::string &className) const
+{
+    static const Names none;
+    std::map<std::string, Names>::const_iterator it = subclasses.find( className );
+
+    return ( it != subclasses.end() ) ? it->second : none;
+}
+
+void ClassHierarchy::link()
+{
+    subclasses.clear();
+
+    // Find the subclasses of each class
+    for(Tds::Module::Classes::const_iterator it = classes.begin(); it != classes.end(); ++it) {
+        const std::vector<std::string> &parents = it->second.parents;
+
+        for(unsigned int i = 0; i < parents.size(); ++i) {
+            Names resolved;
+
+            resolve( it->second.scope, parents[ i ], resolved );
+
+            for(Names::const_iterator itParent = resolved.begin(); itParent != resolved.end(); ++itParent) {
+                subclasses[ *itParent ].insert( it->first );
+            }
+        }
+    }
+}
+
+void ClassHierarchy::seal()
+{
+    sealedClasses.clear();
+    sealedMethods.clear();
+    link();
+
+    // Leaves are final, as well as the virtual methods not overridden in other classes
+    for(Tds::Module::Classes::const_iterator it = classes.begin(); it != classes.end(); ++it) {
+        const Names &virtualMethods = it->second.virtualMethods;
+
+        if ( isExcluded( it->first ) ) {
+            continue;
+        }
+
+        if ( subclasses.find( it->first ) == subclasses.end() ) {
+            sealedClasses.insert( it->first );
+        }
+        else {
+            for(Names::const_iterator itMth = virtualMethods.begin(); itMth != virtualMethods.end(); ++itMth)
+            {
+                if ( !isOverridden( it->first, *itMth ) ) {
+                    sealedMethods.insert( it->first + Tds::Member::AccessOperator + *itMth );
+                }
+            }
+        }
+    }
+}
+
+}
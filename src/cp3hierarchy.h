@@ -0,0 +1,83 @@
+#ifndef CP3HIERARCHY_H_INCLUDED
+#define CP3HIERARCHY_H_INCLUDED
+
+#include "cp3tds.h"
+
+#include <string>
+#include <map>
+
+namespace Cp3mm {
+
+/**
+    The hierarchy of the classes of all modules in a program, used for
+    sealing them: classes with no subclasses are made final, as well as the
+    virtual methods not overridden in any subclass, so the compiler can
+    devirtualize calls to them.
+    It is also used for the closed hierarchies of a single module.
+    Since it needs to know every subclass, all modules of the program must
+    be given. Classes meant to be derived from outside of the program must
+    be excluded.
+*/
+class ClassHierarchy {
+public:
+    typedef Tds::Module::Names Names;
+
+    /// Adds the classes declared in a module
+    /// @param module The module, once parsed
+    void addModule(const Tds::Module &module);
+
+    /// Excludes a class from sealing, or all classes inside a namespace
+    /// @param name The qualified name of the class or namespace
+    void exclude(const std::string &name)
+        { excluded.insert( name ); }
+
+    /// Finds the subclasses of each class, once all modules are added
+    void link();
+
+    /// Returns the direct subclasses of a class, once linked
+    /// @param className The qualified name of the class
+    const Names &getSubclasses(const std::string &className) const;
+
+    /// Decides which classes and methods are final, once all modules are added
+    void seal();
+
+    /// Determines whether a class is final
+    /// @param className The qualified name of the class
+    bool isSealed(const std::string &className) const
+        { return ( sealedClasses.find( className ) != sealedClasses.end() ); }
+
+    /// Determines whether a virtual method is final
+    /// @param className The qualified name of the class
+    /// @param name The name of the method
+    bool isSealed(const std::string &className, const std::string &name) const
+        { return ( sealedMethods.find( className + Tds::Member::AccessOperator + name )
+                                                                    != sealedMethods.end() ); }
+
+    /// Returns the classes made final, by qualified name
+    const Names &getSealedClasses() const
+        { return sealedClasses; }
+
+    /// Returns the methods made final, by qualified name (i.e., A::Person::toString)
+    const Names &getSealedMethods() const
+        { return sealedMethods; }
+
+private:
+    /// Finds the qualified name of a parent class, as written inside a scope.
+    /// When not found in the scope, nor in the enclosing ones, it could be visible
+    /// through a using directive, so all classes with that name are taken.
+    /// @param parents The Names object in which to store the classes found
+    void resolve(const std::string &scope, const std::string &parentName, Names &parents) const;
+
+    bool isExcluded(const std::string &className) const;
+    bool isOverridden(const std::string &className, const std::string &name) const;
+
+    Tds::Module::Classes classes;
+    std::map<std::string, Names> subclasses;
+    Names excluded;
+    Names sealedClasses;
+    Names sealedMethods;
+};
+
+}
+
+#endif // CP3HIERARCHY_H_INCLUDED
@@ -0,0 +1,259 @@
+// cp3index.cpp
+/*
+    Implementation of the reverse index of imports
+*/
+
+#include "cp3index.h"
+#include "cp3scanner.h"
+#include "cp3resolver.h"
+#include "appinfo.h"
+#include "fileman.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace Cp3mm {
+
+const std::string ReverseIndex::DefaultFileName = "cp3.idx";
+const char ReverseIndex::Magic[ 8 ] = { 'C', 'P', '3', 'I', 'D', 'X', '1', 0 };
+
+std::string ReverseIndex::normalize(const std::string &fileName)
+{
+    return Driver::getNormalizedFileName( fileName );
+}
+
+void ReverseIndex::build(const std::string &fileName,
+                         const std::vector<std::string> &moduleNames,
+                         const Options &opts,
+                         ImportResolver &resolver)
+{
+    std::vector<std::string> sorted;
+    std::vector<Parser::ModuleScanner> scanners;
+    std::map<std::string, uint32_t> indexes;
+    std::vector< std::vector<uint32_t> > importedBy;
+    std::vector<Module> entries;
+    std::vector<uint32_t> allImporters;
+    std::string strings;
+    Header header;
+
+    // Modules are stored sorted by name, so they can be looked for quickly
+    for(unsigned int i = 0; i < moduleNames.size(); ++i) {
+        if ( AppInfo::isAcceptedExt( FileMan::getExt( moduleNames[ i ] ) ) ) {
+            sorted.push_back( normalize( moduleNames[ i ] ) );
+        }
+    }
+
+    std::sort( sorted.begin(), sorted.end() );
+    sorted.erase( std::unique( sorted.begin(), sorted.end() ), sorted.end() );
+
+    for(unsigned int i = 0; i < sorted.size(); ++i) {
+        indexes[ sorted[ i ] ] = i;
+        scanners.push_back( Parser::ModuleScanner( sorted[ i ], true ) );
+    }
+
+    Parser::ModuleScanner::scanAll( scanners, opts.numJobs );
+
+    // Find the importers of each module
+    importedBy.resize( sorted.size() );
+
+    for(unsigned int i = 0; i < scanners.size(); ++i) {
+        const std::string dir = Driver::getDirectory( sorted[ i ] );
+        Parser::ModuleScanner::Headers headers = scanners[ i ].getImports();
+        std::string source;
+
+        headers.insert( headers.end(),
+                        scanners[ i ].getIncludes().begin(),
+                        scanners[ i ].getIncludes().end() );
+
+        for(unsigned int j = 0; j < headers.size(); ++j) {
+            if ( resolver.findModule( headers[ j ], dir, source ) ) {
+                std::map<std::string, uint32_t>::const_iterator it = indexes.find( source );
+
+                if ( it != indexes.end()
+                  && it->second != i )
+                {
+                    importedBy[ it->second ].push_back( i );
+                }
+            }
+        }
+    }
+
+    // Lay out the tables
+    for(unsigned int i = 0; i < sorted.size(); ++i) {
+        std::vector<uint32_t> &imp = importedBy[ i ];
+        Module entry;
+
+        std::sort( imp.begin(), imp.end() );
+        imp.erase( std::unique( imp.begin(), imp.end() ), imp.end() );
+
+        entry.name = strings.length();
+        strings += sorted[ i ];
+        strings += '\0';
+
+        entry.header = strings.length();
+        strings += Driver::getOutputName( opts, sorted[ i ], AppInfo::CHeaderFilesExt );
+        strings += '\0';
+
+        entry.firstImporter = allImporters.size();
+        entry.numImporters = imp.size();
+        allImporters.insert( allImporters.end(), imp.begin(), imp.end() );
+
+        entries.push_back( entry );
+    }
+
+    std::memset( &header, 0, sizeof( header ) );
+    std::memcpy( header.magic, Magic, sizeof( header.magic ) );
+    header.numModules = entries.size();
+    header.numImporters = allImporters.size();
+    header.namesSize = strings.length();
+
+    // Write it, replacing the old one at once for whoever is reading it
+    const std::string tempFileName = fileName + ".tmp";
+    FILE * f = std::fopen( tempFileName.c_str(), "wb" );
+
+    if ( f == NULL ) {
+        throw std::runtime_error( "unable to create '" + tempFileName + "' file" );
+    }
+
+    std::fwrite( &header, sizeof( header ), 1, f );
+
+    if ( !entries.empty() ) {
+        std::fwrite( &entries[ 0 ], sizeof( Module ), entries.size(), f );
+    }
+
+    if ( !allImporters.empty() ) {
+        std::fwrite( &allImporters[ 0 ], sizeof( uint32_t ), allImporters.size(), f );
+    }
+
+    std::fwrite( strings.data(), 1, strings.length(), f );
+
+    // Always closed, and not left behind when unfinished
+    bool written = ( std::ferror( f ) == 0 );
+
+    written = ( std::fclose( f ) == 0 ) && written;
+
+    if ( !written
+      || std::rename( tempFileName.c_str(), fileName.c_str() ) != 0 )
+    {
+        unlink( tempFileName.c_str() );
+        throw std::runtime_error( "unable to write '" + fileName + "' file" );
+    }
+}
+
+ReverseIndex::ReverseIndex(const std::string &fileName)
+    : contents( MAP_FAILED ), size( 0 )
+{
+    int fd = open( fileName.c_str(), O_RDONLY );
+    struct stat info;
+
+    if ( fd < 0 ) {
+        throw std::runtime_error( "unable to read '" + fileName + "' file" );
+    }
+
+    if ( fstat( fd, &info ) == 0
+      && info.st_size >= (off_t) sizeof( Header ) )
+    {
+        size = info.st_size;
+        contents = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+    }
+
+    close( fd );
+
+    if ( contents == MAP_FAILED ) {
+        throw std::runtime_error( "unable to map '" + fileName + "' file" );
+    }
+
+    // Locate the tables, checking they fit in the file
+    header = (const Header *) contents;
+
+    if ( std::memcmp( header->magic, Magic, sizeof( Magic ) ) != 0
+      || size != sizeof( Header )
+               + (size_t) header->numModules * sizeof( Module )
+               + (size_t) header->numImporters * sizeof( uint32_t )
+               + header->namesSize )
+    {
+        munmap( contents, size );
+        throw std::runtime_error( "'" + fileName + "' is not a valid index" );
+    }
+
+    modules = (const Module *) ( header + 1 );
+    importers = (const uint32_t *) ( modules + header->numModules );
+    names = (const char *) ( importers + header->numImporters );
+}
+
+ReverseIndex::~ReverseIndex()
+{
+    munmap( contents, size );
+}
+
+int ReverseIndex::find(const std::string &name) const
+{
+    int low = 0;
+    int high = (int) header->numModules - 1;
+    int toret = -1;
+
+    while( low <= high ) {
+        const int mid = ( low + high ) / 2;
+        const int cmp = std::strcmp( getModuleName( mid ), name.c_str() );
+
+        if ( cmp == 0 ) {
+            toret = mid;
+            break;
+        }
+        else
+        if ( cmp < 0 )
+                low = mid + 1;
+        else    high = mid - 1;
+    }
+
+    return toret;
+}
+
+void ReverseIndex::getAffected(const std::vector<std::string> &changed,
+                               std::vector<uint32_t> &affected,
+                               std::vector<std::string> &missing) const
+{
+    std::vector<bool> visited( header->numModules, false );
+    std::vector<uint32_t> pending;
+
+    affected.clear();
+    missing.clear();
+
+    for(unsigned int i = 0; i < changed.size(); ++i) {
+        const std::string name = normalize( changed[ i ] );
+        const int pos = find( name );
+
+        if ( pos >= 0 ) {
+            pending.push_back( pos );
+        }
+        else missing.push_back( name );
+    }
+
+    while( !pending.empty() ) {
+        const uint32_t current = pending.back();
+        pending.pop_back();
+
+        if ( visited[ current ] ) {
+            continue;
+        }
+
+        visited[ current ] = true;
+        affected.push_back( current );
+
+        const Module &module = modules[ current ];
+        for(uint32_t i = 0; i < module.numImporters; ++i) {
+            pending.push_back( importers[ module.firstImporter + i ] );
+        }
+    }
+
+    std::sort( affected.begin(), affected.end() );
+}
+
+}
@@ -0,0 +1,105 @@
+#ifndef CP3INDEX_H_INCLUDED
+#define CP3INDEX_H_INCLUDED
+
+#include "cp3driver.h"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace Cp3mm {
+
+/**
+    A project-wide index of the modules importing each module,
+    stored in a single binary file, so it can be mapped in memory and
+    queried without reading any source or dependency file.
+    The layout of the file is, in native byte order:
+        Header      magic, number of modules, number of importers, size of names
+        Modules     { name, header, first importer, number of importers },
+                    sorted by name, names being offsets in Names
+        Importers   the indexes of the modules importing each module
+        Names       nul-terminated strings
+*/
+class ReverseIndex {
+public:
+    /// Default name for the index file
+    static const std::string DefaultFileName;
+
+    /// Marks the beginning of index files
+    static const char Magic[ 8 ];
+
+    /// Creates a new index file for a set of modules
+    /// @param fileName The name of the index file
+    /// @param modules The modules to index
+    /// @param opts The options, holding search paths and output directory
+    /// @param resolver The resolver to find imported modules with
+    /// @throw std::runtime_error if the modules or the index cannot be read or written
+    static void build(const std::string &fileName,
+                      const std::vector<std::string> &modules,
+                      const Options &opts,
+                      ImportResolver &resolver);
+
+    /// Opens an existing index file
+    /// @param fileName The name of the index file
+    /// @throw std::runtime_error if the file cannot be read or is not an index
+    ReverseIndex(const std::string &fileName);
+
+    ~ReverseIndex();
+
+    /// Finds all the modules affected by changes in some modules,
+    /// including themselves
+    /// @param changed The modules changed
+    /// @param affected The vector in which to store the indexes of affected modules
+    /// @param missing The vector in which to store the changed modules not in the index
+    ///                (i.e., added after building it), normalized
+    void getAffected(const std::vector<std::string> &changed,
+                     std::vector<uint32_t> &affected,
+                     std::vector<std::string> &missing) const;
+
+    /// Returns the number of modules in the index
+    uint32_t getNumModules() const
+        { return header->numModules; }
+
+    /// Returns the name of a module
+    const char * getModuleName(uint32_t i) const
+        { return names + modules[ i ].name; }
+
+    /// Returns the name of the header generated for a module
+    const char * getHeaderName(uint32_t i) const
+        { return names + modules[ i ].header; }
+
+    /// Returns the name a module is stored with, relative to the current directory
+    static std::string normalize(const std::string &fileName);
+
+private:
+    struct Header {
+        char magic[ 8 ];
+        uint32_t numModules;
+        uint32_t numImporters;
+        uint32_t namesSize;
+        uint32_t reserved;
+    };
+
+    struct Module {
+        uint32_t name;
+        uint32_t header;
+        uint32_t firstImporter;
+        uint32_t numImporters;
+    };
+
+    ReverseIndex(const ReverseIndex &);
+    ReverseIndex &operator=(const ReverseIndex &);
+
+    int find(const std::string &name) const;
+
+    void * contents;
+    size_t size;
+    const Header * header;
+    const Module * modules;
+    const uint32_t * importers;
+    const char * names;
+};
+
+}
+
+#endif // CP3INDEX_H_INCLUDED
@@ -0,0 +1,210 @@
+// cp3layout.cpp
+/*
+    Implementation of the sizes of types, for estimating the layout of classes,
+    and of the budgets for them
+*/
+
+#include "cp3layout.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <cstdio>
+
+namespace Cp3mm {
+
+const unsigned int FieldSizes::PointerSize = 8;
+
+FieldSizes::FieldSizes()
+{
+    add( Tds::Member::BoolType, 1 );
+    add( Tds::Member::CharType, 1 );
+    add( Tds::Member::IntType, 4 );
+    add( Tds::Member::FloatType, 4 );
+    add( Tds::Member::LongIntType, 8 );
+    add( Tds::Member::DoubleType, 8 );
+
+    add( "std::string", 32 );
+    add( "std::vector", 24 );
+    add( "std::deque", 80 );
+    add( "std::list", 24 );
+    add( "std::map", 48 );
+    add( "std::set", 48 );
+    add( "std::multimap", 48 );
+    add( "std::multiset", 48 );
+    add( "std::pair", 16 );
+    add( "std::auto_ptr", PointerSize );
+    add( "std::unique_ptr", PointerSize );
+    add( "std::shared_ptr", 2 * PointerSize );
+    add( "std::weak_ptr", 2 * PointerSize );
+    add( "size_t", 8 );
+    add( "std::size_t", 8 );
+    add( "int8_t", 1 );
+    add( "uint8_t", 1 );
+    add( "int16_t", 2 );
+    add( "uint16_t", 2 );
+    add( "int32_t", 4 );
+    add( "uint32_t", 4 );
+    add( "int64_t", 8 );
+    add( "uint64_t", 8 );
+}
+
+void FieldSizes::add(const std::string &type, unsigned int size, unsigned int alignment)
+{
+    // The largest power of two dividing the size, up to the size of a pointer
+    if ( alignment == 0 ) {
+        alignment = 1;
+
+        while( alignment < PointerSize
+            && size % ( alignment * 2 ) == 0 )
+        {
+            alignment *= 2;
+        }
+    }
+
+    table[ type ] = Size( size, alignment );
+}
+
+/// Reads a table with a line per name: "name size [alignment]"
+/// @param contents The contents of the table
+/// @param table The map in which to store the sizes, being 0 the alignments not given
+/// @param lines The map in which to store the line of each name, if not NULL
+/// @throw std::runtime_error on malformed lines, giving the line number
+static void readTable(const std::string &contents, std::map<std::string, FieldSizes::Size> &table,
+                      std::map<std::string, unsigned int> * lines = NULL)
+{
+    std::istringstream in( contents );
+    std::string line;
+    unsigned int numLine = 0;
+
+    while( std::getline( in, line ) ) {
+        std::string name;
+        unsigned int size = 0;
+        unsigned int alignment = 0;
+
+        ++numLine;
+        line = line.substr( 0, line.find( '#' ) );
+
+        std::istringstream fields( line );
+
+        if ( !( fields >> name ) ) {
+            continue;
+        }
+
+        if ( !( fields >> size )
+          || size == 0 )
+        {
+            char buffer[ 32 ];
+
+            std::sprintf( buffer, "%u", numLine );
+            throw std::runtime_error( "line " + std::string( buffer ) + ": expected: name size [alignment]" );
+        }
+
+        fields >> alignment;
+        table[ name ] = FieldSizes::Size( size, alignment );
+
+        if ( lines != NULL ) {
+            ( *lines )[ name ] = numLine;
+        }
+    }
+}
+
+void FieldSizes::parse(const std::string &contents)
+{
+    std::map<std::string, Size> types;
+
+    readTable( contents, types );
+
+    for(std::map<std::string, Size>::const_iterator it = types.begin(); it != types.end(); ++it) {
+        add( it->first, it->second.size, it->second.alignment );
+    }
+}
+
+bool FieldSizes::find(const Tds::Attribute &atr, Size &size) const
+{
+    const std::string &type = atr.getType();
+    std::map<std::string, Size>::const_iterator it = table.find( type.substr( 0, type.find( '<' ) ) );
+    bool toret = true;
+
+    if ( atr.isPointer()
+      || atr.isReference() )
+    {
+        size = Size( PointerSize, PointerSize );
+    }
+    else
+    if ( it != table.end() ) {
+        size = it->second;
+    }
+    else {
+        size = Size( PointerSize, PointerSize );
+        toret = false;
+    }
+
+    if ( atr.isAligned()
+      && size.alignment < Tds::Member::CacheLineSize )
+    {
+        size.alignment = Tds::Member::CacheLineSize;
+    }
+
+    return toret;
+}
+
+unsigned int FieldSizes::estimate(const Sizes &fields, unsigned int start, unsigned int minAlignment,
+                                  std::vector<unsigned int> * offsets)
+{
+    unsigned int offset = start;
+    unsigned int alignment = ( start > 0 ) ? PointerSize : 1;
+
+    if ( minAlignment > alignment ) {
+        alignment = minAlignment;
+    }
+
+    for(unsigned int i = 0; i < fields.size(); ++i) {
+        const Size &field = fields[ i ];
+
+        // Padding before the field
+        offset = ( offset + field.alignment - 1 ) / field.alignment * field.alignment;
+
+        if ( offsets != NULL ) {
+            offsets->push_back( offset );
+        }
+
+        offset += field.size;
+
+        if ( field.alignment > alignment ) {
+            alignment = field.alignment;
+        }
+    }
+
+    // Padding at the end, so it can be stored in arrays
+    offset = ( offset + alignment - 1 ) / alignment * alignment;
+
+    return ( offset > 0 ) ? offset : 1;
+}
+
+// ============================================================== LayoutBudgets
+void LayoutBudgets::parse(const std::string &contents, const std::string &f)
+{
+    fileName = f;
+    readTable( contents, budgets, &lines );
+}
+
+bool LayoutBudgets::find(const std::string &className, Budget &budget) const
+{
+    std::map<std::string, Budget>::const_iterator it = budgets.find( className );
+    bool toret = ( it != budgets.end() );
+
+    if ( toret ) {
+        budget = it->second;
+    }
+
+    return toret;
+}
+
+unsigned int LayoutBudgets::getLine(const std::string &className) const
+{
+    std::map<std::string, unsigned int>::const_iterator it = lines.find( className );
+
+    return ( it != lines.end() ) ? it->second : 0;
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef CP3LAYOUT_H_INCLUDED
+#define CP3LAYOUT_H_INCLUDED
+
+#include "cp3tds.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace Cp3mm {
+
+/**
+    The sizes and alignments of the types of fields, used for estimating
+    the layout of classes. Native types, pointers and references are given
+    the sizes of the usual 64 bits platforms (LP64), as well as the most
+    common types of the standard library (as in libstdc++).
+    The sizes of other types are given in a table for the project, with a line
+    per type: "type size [alignment]", being '#' the start of a comment.
+    Templates are looked for without their arguments (i.e., std::vector).
+    Aligned fields are aligned to a cache line.
+*/
+class FieldSizes {
+public:
+    /// The size and alignment of a type, in bytes
+    struct Size {
+        unsigned int size;
+        unsigned int alignment;
+
+        Size(unsigned int s = 0, unsigned int a = 1)
+            : size( s ), alignment( a )
+            {}
+    };
+
+    /// The sizes of a list of fields, in order
+    typedef std::vector<Size> Sizes;
+
+    /// The size of pointers and references, also the maximum alignment
+    static const unsigned int PointerSize;
+
+    /// Creates the table, with the sizes of native and standard types
+    FieldSizes();
+
+    /// Adds (or replaces) the size of a type
+    /// @param type The name of the type, without template arguments
+    /// @param size The size, in bytes
+    /// @param alignment The alignment, the largest power of two dividing the size if 0
+    void add(const std::string &type, unsigned int size, unsigned int alignment = 0);
+
+    /// Adds the sizes in a table for the project
+    /// @param contents The contents of the table
+    /// @throw std::runtime_error on malformed lines, giving the line number
+    void parse(const std::string &contents);
+
+    /// Finds the size of the type of an attribute
+    /// @param atr The attribute
+    /// @param size The Size object in which to store its size
+    /// @return false if the type is unknown, and the size of a pointer is assumed
+    bool find(const Tds::Attribute &atr, Size &size) const;
+
+    /// Estimates the size of an object holding the given fields, in order
+    /// @param fields The sizes of the fields
+    /// @param start The bytes before the first field (i.e., a pointer to the virtual table)
+    /// @param minAlignment The alignment of the object, when larger than the one of its fields
+    /// @param offsets A vector in which to store the offset of each field, if not NULL
+    static unsigned int estimate(const Sizes &fields, unsigned int start = 0, unsigned int minAlignment = 1,
+                                 std::vector<unsigned int> * offsets = NULL);
+
+private:
+    std::map<std::string, Size> table;
+};
+
+/**
+    The budgets for the layout of classes: the maximum size and alignment of
+    each of them, checked with static assertions in the generated implementation.
+    They are given in a table, with a line per class: "class size [alignment]",
+    being '#' the start of a comment. Classes are given by qualified name.
+*/
+class LayoutBudgets {
+public:
+    /// The maximum size and alignment of a class (alignment 0 when not checked)
+    typedef FieldSizes::Size Budget;
+
+    /// Adds the budgets in a table
+    /// @param contents The contents of the table
+    /// @param f The name of the file holding the table
+    /// @throw std::runtime_error on malformed lines, giving the line number
+    void parse(const std::string &contents, const std::string &f = "");
+
+    /// Finds the budget of a class
+    /// @param className The qualified name of the class
+    /// @param budget The Budget object in which to store it
+    /// @return false if the class has no budget
+    bool find(const std::string &className, Budget &budget) const;
+
+    /// Returns the line of the budget of a class in the table, 0 if not found
+    unsigned int getLine(const std::string &className) const;
+
+    /// Returns the name of the file holding the table
+    const std::string &getFileName() const
+        { return fileName; }
+
+private:
+    std::map<std::string, Budget> budgets;
+    std::map<std::string, unsigned int> lines;
+    std::string fileName;
+};
+
+}
+
+#endif // CP3LAYOUT_H_INCLUDED
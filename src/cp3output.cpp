@@ -0,0 +1,31 @@
+// cp3output.cpp
+/*
+    Implementation of the in-memory output files
+*/
+
+#include "cp3output.h"
+#include "cp3driver.h"
+#include "cp3protocol.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace Cp3mm {
+
+void OutputBuffer::save() const
+{
+    Driver::writeFile( fileName, contents );
+}
+
+void OutputBuffer::save(int fd) const
+{
+    if ( !Protocol::writeAll( fd, contents ) ) {
+        char buffer[ 32 ];
+
+        std::sprintf( buffer, "%d", fd );
+        throw std::runtime_error(
+                "unable to write '" + fileName + "' to descriptor " + buffer );
+    }
+}
+
+}
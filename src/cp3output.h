@@ -0,0 +1,83 @@
+#ifndef CP3OUTPUT_H_INCLUDED
+#define CP3OUTPUT_H_INCLUDED
+
+#include <string>
+
+namespace Cp3mm {
+
+/**
+    An output file kept in memory, with the same interface the parser
+    uses from OutputFile. Once generated, the contents can be saved
+    to the file it is named after, or written to any file descriptor,
+    so modules can be generated without touching the file system.
+*/
+class OutputBuffer {
+public:
+    /// Creates a new, empty buffer
+    /// @param fn The name of the file this buffer stands for
+    OutputBuffer(const std::string &fn)
+        : fileName( fn ), open( true ), lineInfo( true )
+        {}
+
+    /// Returns the name of the file this buffer stands for
+    const std::string &getFileName() const
+        { return fileName; }
+
+    /// Determines whether more contents can be written
+    bool isOpen() const
+        { return open; }
+
+    /// Appends contents to the buffer
+    void write(const std::string &s)
+        { if ( open ) contents.append( s ); }
+
+    /// Appends contents to the buffer, followed by an end of line
+    void writeLn(const std::string &s = "")
+        { write( s ); write( "\n" ); }
+
+    /// Does nothing: contents are only written when saved
+    void flush()
+        {}
+
+    /// Determines whether line directives (#line) are written to this buffer
+    bool hasLineInfo() const
+        { return lineInfo; }
+
+    /// Allows or prevents writing line directives (#line) to this buffer,
+    /// so its contents do not change when lines are added to the module
+    void setLineInfo(bool l)
+        { lineInfo = l; }
+
+    /// Prevents more contents from being written
+    void close()
+        { open = false; }
+
+    /// Inserts contents at a given position, even if no more contents can be written
+    /// @param pos The position, as the length of the contents at some point
+    /// @param s The contents to insert
+    void insert(std::string::size_type pos, const std::string &s)
+        { contents.insert( pos, s ); }
+
+    /// Returns all the contents written so far
+    const std::string &getContents() const
+        { return contents; }
+
+    /// Writes the contents to the file this buffer stands for
+    /// @throw std::runtime_error if the file cannot be created
+    void save() const;
+
+    /// Writes the contents to a file descriptor (i.e., STDOUT_FILENO)
+    /// @param fd The file descriptor to write to
+    /// @throw std::runtime_error if the contents cannot be written
+    void save(int fd) const;
+
+private:
+    std::string fileName;
+    std::string contents;
+    bool open;
+    bool lineInfo;
+};
+
+}
+
+#endif // CP3OUTPUT_H_INCLUDED
@@ -4,18 +4,29 @@
 */
 
 #include "cp3parser.h"
+#include "cp3resolver.h"
+#include "cp3hierarchy.h"
 #include "fileman.h"
 #include "appinfo.h"
 
 #include <stdexcept>
+#include <set>
+#include <cctype>
+#include <cstdio>
+#include <sstream>
 
 namespace Cp3mm {
 
 namespace Parser {
 
-Cp3Parser::Cp3Parser(InputFile &fin, OutputFile &foutH, OutputFile &foutC, Tds::Entity::Strictness levelChk)
+Cp3Parser::Cp3Parser(InputFile &fin, OutputBuffer &foutH, OutputBuffer &foutC,
+                     Tds::Entity::Strictness levelChk, const std::string &moduleName)
         : inputFile( &fin ), outputHeader( &foutH ),
-        outputImpl( &foutC )
+        outputImpl( &foutC ), resolver( NULL ), deferImports( false ),
+        implIncludesPosition( 0 ), privateInImpl( false ), privateDecls( foutC.getFileName() ),
+        inliningPolicy( false ), maxStatementsInlined( 0 ), maxStatementsKeptInline( 0 ),
+        constexprConstants( false ), inlineConstants( false ), charArrays( false ),
+        hierarchy( NULL ), fieldSizes( NULL ), packFields( false ), layoutBudgets( NULL )
 {
     if ( !fin.isOpen() ) {
         throw std::runtime_error( fin.getFileName() + " is not open" );
@@ -32,7 +43,7 @@ Cp3Parser::Cp3Parser(InputFile &fin, OutputFile &foutH, OutputFile &foutC, Tds::
     const std::string & inputPath = inputFile->getFileName();
 
     std::string fileName = FileMan::getOnlyFileName( inputPath );
-    module.setName( fileName );
+    module.setName( moduleName.empty() ? fileName : moduleName );
     Tds::Entity::setStrictness( levelChk );
     onlyFileName = fileName + FileMan::getExt( inputPath );
     fin.close();
@@ -48,6 +59,7 @@ void Cp3Parser::writePreambles()
             + FileMan::getFileName( outputHeader->getFileName()  )
             + '"' )
     ;
+    implIncludesPosition = outputImpl->getContents().length();
 
     // Write the protection for the header
     outputHeader->writeLn(
@@ -69,9 +81,21 @@ void Cp3Parser::writeColophons()
 {
     Tds::EntryPoint * fMain = module.getEntryPoint();
 
+    // Write the variants of the closed hierarchies
+    writeClosedHierarchies();
+
     // Write the header endif's
     outputHeader->writeLn( "#endif // module " + module.getName() );
 
+    // Write the private declarations before any of the implementation
+    writePrivateEntities();
+
+    // Check the layout of the classes with a budget
+    if ( !layoutGuards.empty() ) {
+        outputImpl->writeLn();
+        outputImpl->writeLn( layoutGuards );
+    }
+
     // Write the entry point (if any)
     if ( fMain != NULL ) {
         writeNumLineInfo( outputImpl, *lex, fMain->getLineNumber() );
@@ -124,6 +148,28 @@ void Cp3Parser::processEndings()
             Tds::Class * cl = ns->getCurrentClass();
 
             if ( cl != NULL ) {
+                OutputBuffer * output = getInterfaceOutput();
+
+                if ( fieldSizes != NULL ) {
+                    processLayout( *cl );
+                }
+                else {
+                    const Tds::Container::MembersList &attributes = cl->getAttributes();
+                    std::vector<Tds::Attribute *> fields;
+
+                    for(unsigned int i = 0; i < attributes.size(); ++i) {
+                        Tds::Attribute * atr = (Tds::Attribute *) attributes[ i ];
+
+                        if ( !atr->isStatic()
+                          && !atr->isLazy() )
+                        {
+                            fields.push_back( atr );
+                        }
+                    }
+
+                    chkFalseSharing( *cl, fields );
+                }
+
                 // Prepare
                 Tds::Container * cnt = ns->setOuterAsCurrentContainer();
 
@@ -133,7 +179,7 @@ void Cp3Parser::processEndings()
 
                 // Output
                 lex->advance();
-                outputHeader->writeLn( "}; // class " + cl->getName() );
+                output->writeLn( "}; // class " + cl->getName() );
 
                 // Skip the ';', provided it is there
                 lex->skipDelim();
@@ -237,13 +283,30 @@ void Cp3Parser::process()
         }
         else
         // Is it a class ?
-        if ( token == Tds::Module::RWordClass )
+        if ( token == Tds::Module::RWordClass
+          || token == Tds::Module::RWordClosed )
         {
             updateNumLineInfo( outputHeader );
             processClass();
             continue;
         }
         else
+        // Is it an aligned class or attribute ?
+        if ( token == Tds::Member::MdfAligned )
+        {
+            processAligned();
+            continue;
+        }
+        else
+        // Is it a section of attributes ?
+        if ( module.getState() == Tds::Module::ClassLevel
+          && ( token == Tds::Class::HotSection
+            || token == Tds::Class::ColdSection ) )
+        {
+            processSection();
+            continue;
+        }
+        else
         // Is it a namespace ?
         if ( token == Tds::Module::RWordNamespace )
         {
@@ -297,7 +360,8 @@ void Cp3Parser::processField(Tds::Class &cl, Tds::Attribute &atr)
         initValue = lex->getLiteral( Tds::Member::Semicolon );
 
         // Check availability of initialization
-        if ( atr.getSystemStorage() != &Tds::Member::StaticStorage )
+        if ( atr.getSystemStorage() != &Tds::Member::StaticStorage
+          && !atr.isLazy() )
         {
             throwSyntaxError( "member field must be static to be initialized" );
         }
@@ -310,6 +374,447 @@ void Cp3Parser::processField(Tds::Class &cl, Tds::Attribute &atr)
 
     // Store
     cl.addAttribute( atr );
+
+    if ( atr.isStatic() ) {
+        processInitialization( atr );
+    }
+}
+
+bool Cp3Parser::isPackedField(const Tds::Member &member) const
+{
+    const Tds::Attribute * atr = dynamic_cast<const Tds::Attribute *>( &member );
+
+    // Aligned fields, and fields in sections, stay where they are
+    return ( isDeferredMember( member )
+          && atr != NULL
+          && !atr->isAligned()
+          && atr->getSection() == NULL
+          && atr->getSystemVisibility() != &Tds::Member::PublicVisibility );
+}
+
+bool Cp3Parser::isDeferredMember(const Tds::Member &member) const
+{
+    const Tds::Attribute * atr = dynamic_cast<const Tds::Attribute *>( &member );
+    const Tds::Method * mth = dynamic_cast<const Tds::Method *>( &member );
+    bool toret = false;
+
+    // When packing, the order of fields is only known at the end of the class
+    if ( packFields
+      && fieldSizes != NULL )
+    {
+        if ( atr != NULL ) {
+            toret = ( !atr->isStatic()
+                   && !atr->isLazy() );
+        }
+        else
+        if ( mth != NULL ) {
+            toret = ( mth->isConstructor()
+                   && !mth->getQuickInitList().empty() );
+        }
+    }
+
+    return toret;
+}
+
+void Cp3Parser::splitInitializers(const std::string &list, std::vector<std::string> &inits)
+{
+    const std::string spaces = " \t\n\r";
+    std::string::size_type pos = 0;
+    unsigned int depth = 0;
+
+    inits.clear();
+
+    for(std::string::size_type i = 0; i <= list.length(); ++i) {
+        const char ch = ( i < list.length() ) ? list[ i ] : ',';
+
+        if ( ch == '(' || ch == '[' || ch == '{' ) {
+            ++depth;
+        }
+        else
+        if ( ch == ')' || ch == ']' || ch == '}' ) {
+            --depth;
+        }
+        else
+        if ( ch == ','
+          && depth == 0 )
+        {
+            const std::string init = list.substr( pos, i - pos );
+            const std::string::size_type posBegin = init.find_first_not_of( spaces );
+
+            if ( posBegin != std::string::npos ) {
+                inits.push_back( init.substr( posBegin, init.find_last_not_of( spaces ) + 1 - posBegin ) );
+            }
+
+            pos = i + 1;
+        }
+    }
+}
+
+void Cp3Parser::collectNames(const std::string &code, std::set<std::string> &names, bool onlyOwn)
+{
+    std::string::size_type i = 0;
+
+    while( i < code.length() ) {
+        const char ch = code[ i ];
+
+        // Comments
+        if ( ch == '/'
+          && code.compare( i, 2, "//" ) == 0 )
+        {
+            i = code.find( '\n', i );
+        }
+        else
+        if ( ch == '/'
+          && code.compare( i, 2, "/*" ) == 0 )
+        {
+            i = code.find( "*/", i + 2 );
+            i = ( i == std::string::npos ) ? i : i + 2;
+        }
+        else
+        // Literals
+        if ( ch == '"'
+          || ch == '\'' )
+        {
+            for(++i; i < code.length() && code[ i ] != ch; ++i) {
+                if ( code[ i ] == '\\' ) {
+                    ++i;
+                }
+            }
+            ++i;
+        }
+        else
+        if ( std::isalpha( (unsigned char) ch )
+          || ch == '_' )
+        {
+            const std::string::size_type posName = i;
+            const std::string before = code.substr( 0, posName );
+            const std::string::size_type posPrev = before.find_last_not_of( " \t\n\r" );
+
+            while( i < code.length()
+                && ( std::isalnum( (unsigned char) code[ i ] ) || code[ i ] == '_' ) )
+            {
+                ++i;
+            }
+
+            // Members of other objects are not taken when asked to, save for this->x
+            bool isOwn = ( !onlyOwn
+                        || posPrev == std::string::npos
+                        || ( before[ posPrev ] != '.'
+                          && before[ posPrev ] != ':'
+                          && before[ posPrev ] != '>' ) );
+
+            if ( !isOwn
+              && posPrev > 0
+              && before[ posPrev ] == '>'
+              && before[ posPrev - 1 ] == '-' )
+            {
+                const std::string::size_type posThis = before.find_last_not_of( " \t\n\r", posPrev - 2 );
+
+                isOwn = ( posThis != std::string::npos
+                       && posThis >= 3
+                       && before.compare( posThis - 3, 4, "this" ) == 0 );
+            }
+
+            if ( isOwn ) {
+                names.insert( code.substr( posName, i - posName ) );
+            }
+        }
+        else
+        if ( std::isdigit( (unsigned char) ch ) ) {
+            while( i < code.length()
+                && ( std::isalnum( (unsigned char) code[ i ] ) || code[ i ] == '_' || code[ i ] == '.' ) )
+            {
+                ++i;
+            }
+        }
+        else ++i;
+    }
+}
+
+std::string Cp3Parser::findInitDependency(Tds::Class &cl, const std::vector<Tds::Attribute *> &fields)
+{
+    const Tds::Container::MembersList &methods = cl.getMethods();
+    std::vector<std::string> inits;
+    std::string toret;
+
+    for(unsigned int i = 0; toret.empty() && i < methods.size(); ++i) {
+        Tds::Method * mth = (Tds::Method *) methods[ i ];
+
+        if ( !isDeferredMember( *mth ) ) {
+            continue;
+        }
+
+        // Parameters hide the fields with the same names
+        std::set<std::string> params;
+        collectNames( mth->getParameters(), params );
+        splitInitializers( mth->getQuickInitList(), inits );
+
+        for(unsigned int j = 0; toret.empty() && j < inits.size(); ++j) {
+            const std::string::size_type posArgs = inits[ j ].find( '(' );
+            const std::string name = getInitializedName( inits[ j ] );
+            std::set<std::string> used;
+
+            if ( posArgs == std::string::npos ) {
+                continue;
+            }
+
+            collectNames( inits[ j ].substr( posArgs ), used, true );
+
+            for(unsigned int k = 0; k < fields.size(); ++k) {
+                const std::string &fieldName = fields[ k ]->getName();
+
+                if ( fieldName != name
+                  && used.find( fieldName ) != used.end()
+                  && params.find( fieldName ) == params.end() )
+                {
+                    toret = "the initializer of '" + name + "' reads '" + fieldName + '\'';
+                    break;
+                }
+            }
+        }
+    }
+
+    return toret;
+}
+
+std::string Cp3Parser::getInitializedName(const std::string &init)
+{
+    return init.substr( 0, init.find_first_of( " \t\n\r(" ) );
+}
+
+std::string Cp3Parser::sortInitializers(const std::string &list, const std::vector<Tds::Attribute *> &fields)
+{
+    std::vector<std::string> inits;
+    std::set<std::string> fieldNames;
+    std::string toret;
+
+    splitInitializers( list, inits );
+
+    for(unsigned int j = 0; j < fields.size(); ++j) {
+        fieldNames.insert( fields[ j ]->getName() );
+    }
+
+    // Bases first, as they are initialized first
+    for(unsigned int i = 0; i < inits.size(); ++i) {
+        if ( fieldNames.find( getInitializedName( inits[ i ] ) ) == fieldNames.end() ) {
+            toret += ( toret.empty() ? "" : ", " ) + inits[ i ];
+        }
+    }
+
+    // Then the fields, in the order they are written
+    for(unsigned int j = 0; j < fields.size(); ++j) {
+        for(unsigned int i = 0; i < inits.size(); ++i) {
+            if ( getInitializedName( inits[ i ] ) == fields[ j ]->getName() ) {
+                toret += ( toret.empty() ? "" : ", " ) + inits[ i ];
+            }
+        }
+    }
+
+    return toret;
+}
+
+void Cp3Parser::processLayout(Tds::Class &cl)
+{
+    const std::string className = getQualifiedName( &cl );
+    const Tds::Container::MembersList &attributes = cl.getAttributes();
+    const Tds::Container::MembersList &methods = cl.getMethods();
+    std::vector<Tds::Attribute *> fields;
+    std::vector<Tds::Attribute *> packed;
+    std::vector<Tds::Attribute *> written;
+    std::set<unsigned int> alignments;
+    FieldSizes::Sizes before;
+    FieldSizes::Sizes after;
+    FieldSizes::Size size;
+    unsigned int start = 0;
+    std::string unknownTypes;
+    std::string dependency;
+    const unsigned int alignment = cl.isAligned() ? Tds::Member::CacheLineSize : 1;
+    LayoutBudgets::Budget budget;
+    const bool hasBudget = ( layoutBudgets != NULL
+                          && layoutBudgets->find( className, budget ) );
+
+    // A pointer to the virtual table comes first
+    for(unsigned int i = 0; i < methods.size(); ++i) {
+        if ( methods[ i ]->lookForModifier( Tds::Member::MdfVirtual ) != NULL ) {
+            start = FieldSizes::PointerSize;
+            break;
+        }
+    }
+
+    // Fields in order of appearance, the ones staying where they are coming first after packing
+    for(unsigned int i = 0; i < attributes.size(); ++i) {
+        Tds::Attribute * atr = (Tds::Attribute *) attributes[ i ];
+
+        if ( atr->isStatic()
+          || atr->isLazy() )
+        {
+            continue;
+        }
+
+        if ( !fieldSizes->find( *atr, size )
+          && unknownTypes.find( "'" + atr->getType() + "'" ) == std::string::npos )
+        {
+            if ( !unknownTypes.empty() ) {
+                unknownTypes += ", ";
+            }
+
+            unknownTypes += "'" + atr->getType() + "'";
+        }
+
+        before.push_back( size );
+        fields.push_back( atr );
+
+        if ( isPackedField( *atr ) ) {
+            packed.push_back( atr );
+            alignments.insert( size.alignment );
+        }
+        else written.push_back( atr );
+    }
+
+    // Larger alignments first, keeping the order of fields with the same one
+    for(std::set<unsigned int>::reverse_iterator it = alignments.rbegin(); it != alignments.rend(); ++it) {
+        for(unsigned int i = 0; i < packed.size(); ++i) {
+            fieldSizes->find( *packed[ i ], size );
+
+            if ( size.alignment == *it ) {
+                written.push_back( packed[ i ] );
+            }
+        }
+    }
+
+    // Initializers reading other fields rely on their order of appearance
+    if ( !packed.empty() ) {
+        dependency = findInitDependency( cl, fields );
+
+        if ( !dependency.empty() ) {
+            written = fields;
+        }
+    }
+
+    for(unsigned int i = 0; i < written.size(); ++i) {
+        fieldSizes->find( *written[ i ], size );
+        after.push_back( size );
+
+        if ( isDeferredMember( *written[ i ] ) ) {
+            writeMember( *written[ i ] );
+        }
+    }
+
+    chkFalseSharing( cl, written, after, start );
+
+    // Constructors, initializing the fields in the order they were written
+    for(unsigned int i = 0; i < methods.size(); ++i) {
+        Tds::Method * mth = (Tds::Method *) methods[ i ];
+
+        if ( isDeferredMember( *mth ) ) {
+            mth->setQuickInitList( sortInitializers( mth->getQuickInitList(), written ) );
+            writeMember( *mth );
+        }
+    }
+
+    if ( !packed.empty()
+      || hasBudget )
+    {
+        classLayouts.push_back( ClassLayout( className,
+                                             FieldSizes::estimate( before, start, alignment ),
+                                             FieldSizes::estimate( after, start, alignment ),
+                                             unknownTypes,
+                                             ( !packed.empty() && dependency.empty() ),
+                                             hasBudget ? budget.size : 0,
+                                             dependency ) );
+    }
+
+    if ( hasBudget ) {
+        writeLayoutGuards( cl, budget );
+    }
+}
+
+void Cp3Parser::chkFalseSharing(Tds::Class &cl, const std::vector<Tds::Attribute *> &fields,
+                                const FieldSizes::Sizes &sizes, unsigned int start)
+{
+    const Tds::Attribute * previous = NULL;
+    unsigned int previousEnd = 0;
+    std::vector<unsigned int> offsets;
+
+    if ( Tds::Entity::getStrictnessLevel() != Tds::Entity::HighStrictness ) {
+        return;
+    }
+
+    // With the sizes of the fields, their lines are known
+    if ( !sizes.empty() ) {
+        FieldSizes::estimate( sizes, start, 1, &offsets );
+    }
+
+    // Atomic fields in the same cache line make the threads writing them
+    // invalidate each other's copy of the line (false sharing)
+    for(unsigned int i = 0; i < fields.size(); ++i) {
+        const Tds::Attribute * atr = fields[ i ];
+
+        // Otherwise, an aligned field starts a new cache line
+        if ( offsets.empty()
+          && atr->isAligned() )
+        {
+            previous = NULL;
+        }
+
+        if ( atr->isAtomic()
+          && atr->lookForModifier( Tds::Member::MdfConst ) == NULL )
+        {
+            if ( previous != NULL
+              && ( offsets.empty()
+                || offsets[ i ] / Tds::Member::CacheLineSize == previousEnd / Tds::Member::CacheLineSize ) )
+            {
+                warnings.push_back( "atomic fields '" + previous->getName()
+                                  + "' and '" + atr->getName() + "' of class '"
+                                  + getQualifiedName( &cl ) + "' may share a cache line: "
+                                  + "make them aligned, or place them in different sections" );
+            }
+
+            previous = atr;
+
+            if ( !offsets.empty() ) {
+                previousEnd = offsets[ i ] + ( sizes[ i ].size > 0 ? sizes[ i ].size - 1 : 0 );
+            }
+        }
+    }
+}
+
+void Cp3Parser::writeLayoutGuards(Tds::Class &cl, const LayoutBudgets::Budget &budget)
+{
+    const std::string className = getQualifiedName( &cl );
+    std::string size;
+
+    // Private and protected inner classes cannot be named from outside
+    for(Tds::Class * inner = &cl;
+        dynamic_cast<Tds::Class *>( inner->getContainer() ) != NULL;
+        inner = (Tds::Class *) inner->getContainer())
+    {
+        if ( inner->getClassVisibility() != &Tds::Member::PublicVisibility ) {
+            goto End;
+        }
+    }
+
+    // Failures are reported at the line of the budget
+    if ( !layoutBudgets->getFileName().empty() ) {
+        layoutGuards += "#line " + StringMan::toString( layoutBudgets->getLine( className ) )
+                      + " \"" + layoutBudgets->getFileName() + "\"\n";
+    }
+
+    size = StringMan::toString( budget.size );
+    layoutGuards += "static_assert( sizeof( " + Tds::Member::AccessOperator + className + " ) <= "
+                  + size + ", \"" + className + ": over its size budget of "
+                  + size + " bytes\" );\n";
+
+    if ( budget.alignment > 0 ) {
+        const std::string alignment = StringMan::toString( budget.alignment );
+
+        layoutGuards += "static_assert( alignof( " + Tds::Member::AccessOperator + className + " ) <= "
+                      + alignment + ", \"" + className + ": over its alignment budget of "
+                      + alignment + "\" );\n";
+    }
+
+    End:
+    return;
 }
 
 void Cp3Parser::processQuickList(Tds::Method & mth)
@@ -444,7 +949,40 @@ void Cp3Parser::processMethod(Tds::Class &cl, Tds::Method &mth)
 }
 
 
-void Cp3Parser::processClassMember()
+void Cp3Parser::processAligned()
+{
+    const std::string &token = lex->getToken();
+
+    if ( token == Tds::Module::RWordClass
+      || token == Tds::Module::RWordClosed )
+    {
+        updateNumLineInfo( outputHeader );
+        processClass( true );
+    }
+    else
+    if ( module.getState() == Tds::Module::ClassLevel ) {
+        processClassMember( &Tds::Member::MdfAligned );
+    }
+    else throwSyntaxError( "only classes and attributes can be aligned" );
+}
+
+void Cp3Parser::processSection()
+{
+    Tds::Namespace * ns = module.getCurrentNamespace();
+    Tds::Class * cl = ( ns != NULL ) ? ns->getCurrentClass() : NULL;
+
+    if ( cl == NULL ) {
+        throwSyntaxError( "misplaced section: there is still no class here" );
+    }
+
+    if ( lex->getCurrentToken() == Tds::Class::HotSection )
+            cl->setCurrentSection( &Tds::Class::HotSection );
+    else    cl->setCurrentSection( &Tds::Class::ColdSection );
+
+    skipDelimiter( Tds::Class::Colon );
+}
+
+void Cp3Parser::processClassMember(const std::string * firstModifier)
 /// Add a new member to the current class
 {
     const unsigned int numLine = getNumLine();
@@ -491,6 +1029,11 @@ void Cp3Parser::processClassMember()
         else {
             // Read modifiers
             mdfs.clear();
+
+            if ( firstModifier != NULL ) {
+                mdfs.push_back( firstModifier );
+            }
+
             modifier = Tds::Member::lookForModifierKeyword( token );
             while ( modifier != NULL )
             {
@@ -577,6 +1120,20 @@ void Cp3Parser::processClassMember()
 
             processMethod( *cl, *mth );
             member = mth;
+
+            // Store it in the hierarchy of classes
+            const bool canBeFinal = ( mth->isVirtual()
+                                   && !mth->isPureVirtual()
+                                   && !mth->isDestructor() );
+
+            module.addMethod( getQualifiedName( cl ), name, canBeFinal );
+
+            if ( canBeFinal
+              && hierarchy != NULL
+              && hierarchy->isSealed( getQualifiedName( cl ), name ) )
+            {
+                mth->setFinal();
+            }
         }
         else throwSyntaxError( "invalid member: expected function or field" );
 
@@ -585,24 +1142,49 @@ void Cp3Parser::processClassMember()
         member->setIsReference( isReference );
         member->chk();
 
-        if ( member->getSystemStorage() == &Tds::Member::InlineStorage ) {
-            writeNumLineInfo( outputHeader, *lex, member->getLineNumber() );
-            outputHeader->writeLn( member->getInline() );
-        } else {
-            const std::string &impl = member->getImplementation();
+        if ( inliningPolicy ) {
+            Tds::Method * mth = dynamic_cast<Tds::Method *>( member );
 
-            if ( !impl.empty() ) {
-                writeNumLineInfo( outputImpl, *lex, member->getLineNumber() );
-                outputImpl->writeLn( impl );
+            // Explicit constructors would lose their explicit modifier when inlined
+            if ( mth != NULL
+              && !mth->isPureVirtual() )
+            {
+                applyInliningPolicy( *mth,
+                                     mth->lookForModifier( Tds::Member::MdfExplicit ) == NULL,
+                                     mth->isVirtual() );
             }
+        }
 
-            writeNumLineInfo( outputHeader, *lex, member->getLineNumber() );
-            outputHeader->writeLn( member->getPrototype() );
+        // Fields, and the constructors initializing them, are written at the end of the class
+        if ( !isDeferredMember( *member ) ) {
+            writeMember( *member );
         }
     }
     else throwSyntaxError( "Misplaced member beginning" );
 }
 
+void Cp3Parser::writeMember(Tds::Member &member)
+{
+    OutputBuffer * output = getInterfaceOutput();
+
+    if ( member.getSystemStorage() == &Tds::Member::InlineStorage ) {
+        writeNumLineInfo( output, *lex, member.getLineNumber() );
+        output->writeLn( member.getInline() );
+        addToInterface( Tds::Module::InlineText, member.getInline() );
+    } else {
+        const std::string &impl = member.getImplementation();
+
+        if ( !impl.empty() ) {
+            writeNumLineInfo( outputImpl, *lex, member.getLineNumber() );
+            outputImpl->writeLn( impl );
+        }
+
+        writeNumLineInfo( output, *lex, member.getLineNumber() );
+        output->writeLn( member.getPrototype() );
+        addToInterface( getInterfaceKind( member ), member.getPrototype() );
+    }
+}
+
 void Cp3Parser::processNamespaceMember()
 {
     const unsigned int numLine = getNumLine();
@@ -728,9 +1310,23 @@ void Cp3Parser::processNamespaceMember()
         member->setIsReference( isReference );
         member->chk();
 
+        if ( inliningPolicy ) {
+            Tds::Function * f = dynamic_cast<Tds::Function *>( member );
+
+            // Private functions cannot be inline
+            if ( f != NULL ) {
+                applyInliningPolicy( *f,
+                                     f->getSystemVisibility() != &Tds::Member::PrivateVisibility,
+                                     false );
+            }
+        }
+
+        OutputBuffer * output = getInterfaceOutput( member->getName() );
+
         if ( member->getSystemStorage() == &Tds::Member::InlineStorage ) {
-            writeNumLineInfo( outputHeader, *lex, member->getLineNumber() );
-            outputHeader->writeLn( member->getInline() );
+            writeNumLineInfo( output, *lex, member->getLineNumber() );
+            output->writeLn( member->getInline() );
+            addExport( member->getQualifiedName(), Tds::Module::InlineText, member->getInline() );
         }
         else {
             const std::string &impl = member->getImplementation();
@@ -740,8 +1336,9 @@ void Cp3Parser::processNamespaceMember()
                 outputImpl->writeLn( member->getImplementation() );
             }
 
-            writeNumLineInfo( outputHeader, *lex, member->getLineNumber() );
-            outputHeader->writeLn( member->getPrototype() );
+            writeNumLineInfo( output, *lex, member->getLineNumber() );
+            output->writeLn( member->getPrototype() );
+            addExport( member->getQualifiedName(), getInterfaceKind( *member ), member->getPrototype() );
         }
     }
     else throwSyntaxError( "misplaced member beginning" );
@@ -777,11 +1374,235 @@ void Cp3Parser::processConstant(Tds::Constant &cnst)
 
     // Store
     ns.addConstant( cnst );
+
+    // Maybe its value can be known when compiling other modules
+    // (lazy constants are not initialized at startup, anyway)
+    bool &isCompileTime = namespaceConstants[ cnst.getQualifiedName() ];
+
+    isCompileTime = false;
+    if ( !cnst.isLazy() ) {
+        if ( cnst.hasLiteralType()
+          && isConstantExpression( initValue, getScopeOf( cnst ) ) )
+        {
+            isCompileTime = true;
+
+            if ( constexprConstants ) {
+                cnst.setCompileTime( inlineConstants );
+            }
+        }
+        else processInitialization( cnst );
+    }
 }
 
-void Cp3Parser::processRegularFunction(Tds::Function &f)
+bool Cp3Parser::isStringLiteral(const std::string &expr, unsigned int &length)
+/// Determines whether an expression is a string literal (maybe many, concatenated),
+/// also finding the number of characters in it
 {
-    Tds::Namespace &ns = *module.getCurrentNamespace();
+    bool toret = false;
+
+    length = 0;
+
+    for(std::string::size_type i = 0; i < expr.length(); ++i) {
+        const char ch = expr[ i ];
+
+        if ( ch == '"' ) {
+            for(++i; i < expr.length() && expr[ i ] != ch; ++i) {
+                if ( expr[ i ] == '\\' ) {
+                    ++i;
+                }
+                ++length;
+            }
+
+            toret = ( i < expr.length() );
+        }
+        else
+        if ( !std::isspace( (unsigned char) ch ) ) {
+            toret = false;
+            break;
+        }
+    }
+
+    return toret;
+}
+
+void Cp3Parser::processInitialization(Tds::Data &data)
+/// Stores std::string data initialized with string literals as char arrays, when asked to,
+/// and records the data initialized at startup
+{
+    static const std::string StringType = "std::string";
+    static const std::string UnqualifiedStringType = "string";
+    static const unsigned int MaxLengthWithoutAllocation = 15;
+    const std::string &init = data.getInitialValue();
+    const bool isString = ( data.isUserType()
+                         && !data.isPointer()
+                         && !data.isReference()
+                         && ( data.getType() == StringType
+                           || data.getType() == UnqualifiedStringType ) );
+    unsigned int length;
+    char buffer[ 32 ];
+    std::string cost;
+
+    if ( isString ) {
+        if ( isStringLiteral( init, length ) ) {
+            if ( charArrays
+              && data.lookForModifier( Tds::Member::MdfConst ) != NULL )
+            {
+                data.setCharArray();
+                goto End;
+            }
+
+            // Short strings are stored inside the object, at least in libstdc++ and libc++
+            std::sprintf( buffer, "%u", length );
+            cost = data.getType() + " constructor, " + buffer + " char(s)";
+
+            if ( length > MaxLengthWithoutAllocation ) {
+                cost += ", allocating memory";
+            }
+        }
+        else cost = data.getType() + " constructor";
+    }
+    else
+    if ( data.isUserType()
+      && !data.isPointer()
+      && !data.isReference() )
+    {
+        cost = data.getType() + " constructor";
+    }
+    else
+    if ( !init.empty()
+      && !isStringLiteral( init, length )
+      && !isConstantExpression( init, getScopeOf( data ) ) )
+    {
+        cost = "evaluation of '" + init + '\'';
+    }
+
+    if ( !cost.empty() ) {
+        dynamicInitializers.push_back(
+            DynamicInitializer( data.getQualifiedName(), data.getLineNumber(), cost )
+        );
+    }
+
+    End:
+    return;
+}
+
+std::string Cp3Parser::getScopeOf(Tds::Member &member)
+/// Returns the scope a member is in, as the qualified name of its container,
+/// followed by the access operator (i.e., "Utils::Math::")
+{
+    const std::string qualifiedName = member.getQualifiedName();
+
+    return qualifiedName.substr( 0, qualifiedName.length() - member.getName().length() );
+}
+
+bool Cp3Parser::isCompileTimeConstant(const std::string &name, const std::string &scope) const
+/// Determines whether a name, used in a given scope (i.e., "Utils::Math::"),
+/// is a compile-time constant. It is looked for from that scope outwards, as C++ does,
+/// so a constant not known at compile time hides the ones in outer scopes
+{
+    const std::string &access = Tds::Member::AccessOperator;
+    std::map<std::string, bool>::const_iterator it;
+    std::string prefix = scope;
+    std::string id = name;
+    bool toret = false;
+
+    // Names given from the global namespace are not looked for in any other
+    if ( id.compare( 0, access.length(), access ) == 0 ) {
+        id.erase( 0, access.length() );
+        prefix.clear();
+    }
+
+    for(;;) {
+        it = namespaceConstants.find( prefix + id );
+
+        if ( it != namespaceConstants.end() ) {
+            toret = it->second;
+            break;
+        }
+
+        if ( prefix.empty() ) {
+            break;
+        }
+
+        // Go to the enclosing scope
+        std::string::size_type pos = std::string::npos;
+
+        if ( prefix.length() > access.length() ) {
+            pos = prefix.rfind( access, prefix.length() - access.length() - 1 );
+        }
+
+        if ( pos != std::string::npos )
+                prefix.erase( pos + access.length() );
+        else    prefix.clear();
+    }
+
+    return toret;
+}
+
+bool Cp3Parser::isConstantExpression(const std::string &expr, const std::string &scope) const
+/// Determines whether an expression, in a given scope, is made of literals, operators,
+/// and the compile-time constants found so far
+{
+    static const std::string TrueLiteral = "true";
+    static const std::string FalseLiteral = "false";
+    bool toret = !expr.empty();
+    std::string name;
+
+    for(std::string::size_type i = 0; toret && i < expr.length(); ++i) {
+        const char ch = expr[ i ];
+
+        // Numbers, including suffixes and exponents
+        if ( std::isdigit( (unsigned char) ch ) ) {
+            while( i + 1 < expr.length()
+                && ( std::isalnum( (unsigned char) expr[ i + 1 ] ) || expr[ i + 1 ] == '.' ) )
+            {
+                ++i;
+            }
+        }
+        else
+        // Character literals
+        if ( ch == '\'' ) {
+            for(++i; i < expr.length() && expr[ i ] != ch; ++i) {
+                if ( expr[ i ] == '\\' ) {
+                    ++i;
+                }
+            }
+        }
+        else
+        // Names, possibly qualified
+        if ( std::isalpha( (unsigned char) ch )
+          || ch == '_' )
+        {
+            name.clear();
+            for(; i < expr.length()
+               && ( std::isalnum( (unsigned char) expr[ i ] )
+                 || expr[ i ] == '_'
+                 || expr[ i ] == ':' ); ++i)
+            {
+                name += expr[ i ];
+            }
+            --i;
+
+            toret = ( name == TrueLiteral
+                   || name == FalseLiteral
+                   || isCompileTimeConstant( name, scope ) );
+        }
+        else
+        // No strings, arrays or initializer lists
+        if ( ch == '"'
+          || ch == '['
+          || ch == '{' )
+        {
+            toret = false;
+        }
+    }
+
+    return toret;
+}
+
+void Cp3Parser::processRegularFunction(Tds::Function &f)
+{
+    Tds::Namespace &ns = *module.getCurrentNamespace();
 
     std::string body;
     std::string args;
@@ -943,16 +1764,35 @@ void Cp3Parser::processImport()
             // Prepare filename
             fileName += AppInfo::CHeaderFilesExt;
 
-            // Store it as a dependency
-            module.addDependency( fileName );
+            // Store it as a dependency, where it was found
+            if ( resolver != NULL ) {
+                std::string path;
+
+                if ( !resolver->resolve( fileName, moduleDir, path ) ) {
+                    throw ImportError( ( "module not found: " + fileName ).c_str(), getNumLine() );
+                }
 
-            // Output it
-            std::string outputLine =
-                            Tds::Module::DirectiveMark
-                          + Tds::Module::RWordInclude + ' '
-            ;
-            outputLine += Tds::Module::DoubleQuote + fileName + Tds::Module::DoubleQuote;
-            outputHeader->writeLn( outputLine );
+                module.addDependency( path );
+                module.addFileDependency( path );
+                module.addImport( path );
+            } else {
+                module.addDependency( fileName );
+                module.addFileDependency( fileName );
+                module.addImport( fileName );
+            }
+
+            // Output it, maybe later
+            if ( deferImports ) {
+                deferredImports.push_back(
+                        DeferredImport( fileName, outputHeader->getContents().length() ) );
+            } else {
+                std::string outputLine =
+                                Tds::Module::DirectiveMark
+                              + Tds::Module::RWordInclude + ' '
+                ;
+                outputLine += Tds::Module::DoubleQuote + fileName + Tds::Module::DoubleQuote;
+                outputHeader->writeLn( outputLine );
+            }
 
             skipDelimiter( Tds::Member::Semicolon );
         }
@@ -975,10 +1815,30 @@ void Cp3Parser::processTypedef()
         std::string typedefContents = lex->getLiteral( Tds::Member::Semicolon );
         lex->skipDelim();
 
+        // The name is the last one, or the one of the pointer to function
+        std::string::size_type posName = typedefContents.find( "(*" );
+        std::string::size_type posEnd;
+
+        if ( posName != std::string::npos ) {
+            posName = typedefContents.find_first_not_of( " \t\n\r", posName + 2 );
+            posEnd = typedefContents.find_first_of( " \t\n\r)", posName );
+        } else {
+            posEnd = typedefContents.find_last_not_of( " \t\n\r" ) + 1;
+            posName = posEnd;
+
+            while( posName > 0
+                && ( std::isalnum( (unsigned char) typedefContents[ posName - 1 ] )
+                  || typedefContents[ posName - 1 ] == '_' ) )
+            {
+                --posName;
+            }
+        }
+
         // Output it
         std::string outputLine = Tds::Module::RWordTypedef + ' ';
         outputLine += typedefContents + Tds::Member::Semicolon;
-        outputHeader->writeLn( outputLine );
+        getInterfaceOutput( typedefContents.substr( posName, posEnd - posName ) )->writeLn( outputLine );
+        addToInterface( Tds::Module::DeclarationText, outputLine );
     }
 }
 
@@ -1023,6 +1883,19 @@ void Cp3Parser::processDirective()
             {
                 FileMan::replaceExtCnvt( iFileName, AppInfo::CHeaderFilesExt );
             }
+            else
+            if ( *delim == '"'
+              && !iFileName.empty()
+              && iFileName[ 0 ] != '/' )
+            {
+                // Not generated: it stays in the directory of the module
+                iFileName = sourceDir + iFileName;
+            }
+
+            if ( *delim == '"' )
+            {
+                module.addFileDependency( iFileName );
+            }
 
             // Recreate the include in output file
             std::string outputLine = '#' + Tds::Module::RWordInclude + ' ';
@@ -1138,6 +2011,27 @@ std::string Cp3Parser::getReference()
         lex->skipDelim();
     }
 
+    // It can have template arguments (i.e., std::atomic<std::size_t>)
+    if ( lex->getCurrentChar() == '<' ) {
+        int nestingLevel = 0;
+
+        do {
+            if ( lex->getCurrentChar() == '<' ) {
+                ++nestingLevel;
+            }
+            else
+            if ( lex->getCurrentChar() == '>' ) {
+                --nestingLevel;
+            }
+
+            toret += lex->getCurrentChar();
+            lex->advance();
+        } while( nestingLevel > 0
+              && !lex->isEnd() );
+
+        lex->skipDelim();
+    }
+
     return toret;
 }
 
@@ -1175,7 +2069,7 @@ void Cp3Parser::processNamespace()
     else throwSyntaxError( "namespace expected" );
 }
 
-void Cp3Parser::processClass()
+void Cp3Parser::processClass(bool aligned)
 {
     Tds::Class::ParentList parentList;
     std::string visibility;
@@ -1196,6 +2090,20 @@ void Cp3Parser::processClass()
 
     systemClsVisibility = cnt->getCurrentVisibility();
 
+    // Read the prefixes: is it the root of a closed hierarchy, or aligned ?
+    bool closed = false;
+
+    for(;;) {
+        if ( lex->getCurrentToken() == Tds::Module::RWordClosed )
+            closed = true;
+        else
+        if ( lex->getCurrentToken() == Tds::Member::MdfAligned )
+            aligned = true;
+        else break;
+
+        lex->getToken();
+    }
+
     // Move on to the 'class' keyword
     if ( lex->getCurrentToken() != Tds::Module::RWordClass )
     {
@@ -1246,8 +2154,50 @@ void Cp3Parser::processClass()
             currentClass->setParentList( parentList );
         }
 
+        // Store it in the hierarchy of classes
+        const std::string className = getQualifiedName( currentClass );
+        std::vector<std::string> parentNames;
+
+        for(unsigned int i = 0; i < parentList.size(); ++i) {
+            parentNames.push_back( parentList[ i ].getParentName() );
+        }
+
+        module.addClass( className, getQualifiedName( currentClass->getContainer() ), parentNames );
+
+        if ( hierarchy != NULL
+          && hierarchy->isSealed( className ) )
+        {
+            currentClass->setFinal();
+        }
+
+        if ( aligned ) {
+            currentClass->setAligned();
+        }
+
+        if ( closed ) {
+            if ( currentClass->getContainer() != ns ) {
+                throwSyntaxError( "only classes directly inside a namespace can be closed" );
+            }
+
+            currentClass->setClosed();
+        }
+
         // Produce class
-        outputHeader->write( currentClass->getDeclaration() );
+        OutputBuffer * output = getInterfaceOutput();
+
+        if ( output == outputHeader ) {
+            headerClasses.push_back( currentClass );
+        }
+
+        output->write( currentClass->getDeclaration() );
+        addToInterface( Tds::Module::DeclarationText, currentClass->getDeclaration() );
+
+        // Private classes are exported only if they stay in the header
+        if ( currentClass->getContainer() == ns
+          && output == outputHeader )
+        {
+            module.addExportedClass( getQualifiedName( currentClass ) );
+        }
     }
     else throwSyntaxError( ( "expected: " + Tds::Module::RWordClass ).c_str() );
 
@@ -1255,6 +2205,632 @@ void Cp3Parser::processClass()
     return;
 }
 
+std::string Cp3Parser::openNamespaces(const std::string &nsName, std::string &closing)
+{
+    const std::string &access = Tds::Member::AccessOperator;
+    std::string::size_type pos = 0;
+    std::string::size_type posEnd;
+    std::string toret;
+
+    // namespace A { namespace B {
+    do {
+        posEnd = nsName.find( access, pos );
+        toret += Tds::Module::RWordNamespace + ' '
+               + nsName.substr( pos, posEnd - pos )
+               + ' ' + Tds::Method::OpenBrace + ' ';
+        closing += " }";
+        pos = posEnd + access.length();
+    } while( posEnd != std::string::npos );
+
+    return toret;
+}
+
+std::string Cp3Parser::getForwardDeclaration(const std::string &className)
+{
+    const std::string::size_type pos = className.rfind( Tds::Member::AccessOperator );
+    std::string closing;
+    std::string toret;
+
+    // namespace A { namespace B { class C; } }
+    if ( pos != std::string::npos ) {
+        toret = openNamespaces( className.substr( 0, pos ), closing );
+        toret += Tds::Module::RWordClass + ' '
+               + className.substr( pos + Tds::Member::AccessOperator.length() );
+    }
+    else toret = Tds::Module::RWordClass + ' ' + className;
+
+    return toret + Tds::Member::Semicolon + closing;
+}
+
+bool Cp3Parser::getArguments(const std::string &parameters, std::string &args)
+{
+    const std::string spaces = " \t\n\r";
+    std::string::size_type pos = 0;
+    unsigned int depth = 0;
+    bool toret = true;
+
+    args.clear();
+
+    for(std::string::size_type i = 0; toret && i <= parameters.length(); ++i) {
+        const char ch = ( i < parameters.length() ) ? parameters[ i ] : ',';
+
+        if ( ch == '<' || ch == '(' || ch == '[' ) {
+            ++depth;
+        }
+        else
+        if ( ch == '>' || ch == ')' || ch == ']' ) {
+            --depth;
+        }
+        else
+        if ( ch == ','
+          && depth == 0 )
+        {
+            // Take the name, at the end of the parameter
+            std::string param = parameters.substr( pos, i - pos );
+            const std::string::size_type posBegin = param.find_first_not_of( spaces );
+            const std::string::size_type posEnd = param.find_last_not_of( spaces );
+            std::string::size_type posName = posEnd;
+
+            pos = i + 1;
+
+            if ( posEnd == std::string::npos
+              || param.substr( posBegin, posEnd + 1 - posBegin ) == Tds::Member::VoidType )
+            {
+                continue;
+            }
+
+            while( posName > 0
+                && ( std::isalnum( param[ posName - 1 ] ) || param[ posName - 1 ] == '_' ) )
+            {
+                --posName;
+            }
+
+            // Unnamed parameters cannot be passed on
+            const std::string name = param.substr( posName, posEnd + 1 - posName );
+
+            toret = ( posName > posBegin
+                   && ( std::isalpha( name[ 0 ] ) || name[ 0 ] == '_' )
+                   && Tds::Member::lookForTypeKeyword( name ) == NULL );
+
+            if ( !args.empty() ) {
+                args += ", ";
+            }
+
+            args += name;
+        }
+    }
+
+    return toret;
+}
+
+std::string Cp3Parser::getClosedHierarchy(const ClassHierarchy &classes, Tds::Class &base)
+{
+    const std::string &access = Tds::Member::AccessOperator;
+    const std::string nsName = getQualifiedName( base.getContainer() );
+    const std::string variantName = base.getName() + "Variant";
+    const std::string dispatchName = base.getName() + "Dispatch";
+    const Tds::Container::MembersList &methods = base.getMethods();
+    std::map<std::string, Tds::Module::Names> pureMethods;
+    Tds::Module::Names members;
+    std::string alternatives;
+    std::string dispatch;
+    std::string closing;
+    std::string toret;
+
+    // The concrete classes in the hierarchy (parents are always declared first)
+    members.insert( getQualifiedName( &base ) );
+
+    for(unsigned int i = 0; i < headerClasses.size(); ++i) {
+        const std::string className = getQualifiedName( headerClasses[ i ] );
+        const Tds::Container::MembersList &clMethods = headerClasses[ i ]->getMethods();
+        const Tds::Module::Names &subclasses = classes.getSubclasses( className );
+        Tds::Module::Names &pure = pureMethods[ className ];
+
+        if ( members.find( className ) == members.end() ) {
+            continue;
+        }
+
+        // Methods left pure in the parents, or in this class, make it abstract
+        for(unsigned int j = 0; j < clMethods.size(); ++j) {
+            const Tds::Method * mth = (const Tds::Method *) clMethods[ j ];
+
+            if ( mth->isPureVirtual() )
+                    pure.insert( mth->getName() );
+            else    pure.erase( mth->getName() );
+        }
+
+        if ( pure.empty() ) {
+            if ( !alternatives.empty() ) {
+                alternatives += ", ";
+            }
+
+            alternatives += access + className;
+        }
+
+        for(Tds::Module::Names::const_iterator it = subclasses.begin(); it != subclasses.end(); ++it) {
+            members.insert( *it );
+            pureMethods[ *it ].insert( pure.begin(), pure.end() );
+        }
+    }
+
+    if ( alternatives.empty() ) {
+        goto End;
+    }
+
+    // The public methods of the base, called on the alternative held
+    for(unsigned int i = 0; i < methods.size(); ++i) {
+        Tds::Method * mth = (Tds::Method *) methods[ i ];
+        const std::string qualifier = mth->isConstMethod() ? Tds::Member::MdfConst + ' ' : "";
+        std::string parameters = mth->getParameters();
+        std::string args;
+
+        Tds::Method::processParameters( parameters );
+
+        if ( mth->getSystemVisibility() != &Tds::Member::PublicVisibility
+          || mth->getSystemStorage() == &Tds::Member::StaticStorage
+          || mth->isConstructor()
+          || mth->isDestructor()
+          || !getArguments( parameters, args ) )
+        {
+            continue;
+        }
+
+        if ( !args.empty() ) {
+            parameters = ", " + parameters;
+            args = ' ' + args + ' ';
+        }
+        else parameters.clear();
+
+        dispatch += "    " + Tds::Member::StaticStorage + mth->getReturnType()
+                  + ' ' + mth->getName()
+                  + " (" + qualifier + variantName + " &cp3Variant" + parameters + ")\n"
+                  + "        { return std::visit( [&]( " + qualifier + "auto &cp3Object ) ->"
+                  + mth->getReturnType() + " { typedef typename std::decay<decltype( cp3Object )>::type Cp3Type;"
+                  + " return cp3Object.Cp3Type::" + mth->getName() + '(' + args + "); }, cp3Variant ); }\n"
+        ;
+    }
+
+    // namespace A { typedef std::variant<...> BaseVariant; struct BaseDispatch {...}; }
+    toret = openNamespaces( nsName, closing );
+    toret += "\n\n/// The closed hierarchy of " + base.getName() + ", as a value type\n"
+          + Tds::Module::RWordTypedef + " std::variant< " + alternatives + " > " + variantName
+          + Tds::Member::Semicolon + "\n\n"
+          + "/// Calls the methods of " + base.getName() + " on a " + variantName
+          + ", with no indirect calls\n"
+          + "struct " + dispatchName + ' ' + Tds::Method::OpenBrace + '\n'
+          + dispatch
+          + '}' + Tds::Member::Semicolon + '\n'
+          + closing.substr( 1 ) + "\n\n"
+    ;
+
+    module.addExport( nsName + access + variantName, Tds::Module::DeclarationText,
+                      "std::variant< " + alternatives + " >" );
+    module.addExport( nsName + access + dispatchName, Tds::Module::InlineText, dispatch );
+
+    End:
+    return toret;
+}
+
+void Cp3Parser::writeClosedHierarchies()
+{
+    ClassHierarchy classes;
+    std::string text;
+
+    classes.addModule( module );
+    classes.link();
+
+    for(unsigned int i = 0; i < headerClasses.size(); ++i) {
+        if ( headerClasses[ i ]->isClosed() ) {
+            text += getClosedHierarchy( classes, *headerClasses[ i ] );
+        }
+    }
+
+    if ( !text.empty() ) {
+        outputHeader->writeLn();
+        outputHeader->writeLn( Tds::Module::DirectiveMark + Tds::Module::RWordInclude + " <variant>" );
+        outputHeader->writeLn( Tds::Module::DirectiveMark + Tds::Module::RWordInclude + " <type_traits>" );
+        outputHeader->writeLn();
+        outputHeader->write( text );
+    }
+}
+
+void Cp3Parser::writeDeferredImports()
+{
+    std::string implIncludes;
+
+    // From the last one, so the positions of the remaining ones are still valid
+    for(DeferredImports::reverse_iterator it = deferredImports.rbegin(); it != deferredImports.rend(); ++it)
+    {
+        const std::string include =
+                        Tds::Module::DirectiveMark
+                      + Tds::Module::RWordInclude + ' '
+                      + Tds::Module::DoubleQuote + it->header + Tds::Module::DoubleQuote
+                      + '\n'
+        ;
+
+        if ( it->inHeader ) {
+            outputHeader->insert( it->position, include );
+        } else {
+            std::string declarations;
+
+            for(unsigned int i = 0; i < it->classes.size(); ++i) {
+                declarations += getForwardDeclaration( it->classes[ i ] ) + '\n';
+            }
+
+            outputHeader->insert( it->position, declarations );
+            implIncludes.insert( 0, include );
+        }
+    }
+
+    outputImpl->insert( implIncludesPosition, implIncludes );
+    deferredImports.clear();
+}
+
+std::string Cp3Parser::getQualifiedName(Tds::Container * cnt)
+{
+    std::string toret = cnt->getName();
+
+    for(cnt = cnt->getContainer(); cnt != NULL; cnt = cnt->getContainer()) {
+        toret = cnt->getName() + Tds::Member::AccessOperator + toret;
+    }
+
+    return toret;
+}
+
+Tds::Module::InterfaceKind Cp3Parser::getInterfaceKind(const Tds::Member &member)
+{
+    Tds::Module::InterfaceKind toret = Tds::Module::SignatureText;
+
+    if ( dynamic_cast<const Tds::Data *>( &member ) != NULL ) {
+        // Lazy data is defined in its accessor
+        if ( member.isLazy() )
+                toret = Tds::Module::InlineText;
+        else    toret = Tds::Module::DataText;
+    }
+
+    return toret;
+}
+
+bool Cp3Parser::isPrivateContext()
+{
+    Tds::Namespace * ns = module.getCurrentNamespace();
+    bool toret = false;
+
+    if ( privateInImpl
+      && ns != NULL )
+    {
+        Tds::Container * cl = getOutermostClass();
+
+        // Classes inside a private class are private as well
+        if ( cl != NULL )
+                toret = ( ( (Tds::Class *) cl )->getClassVisibility() == &Tds::Member::PrivateVisibility );
+        else    toret = ( ns->getCurrentVisibility() == &Tds::Member::PrivateVisibility );
+    }
+
+    return toret;
+}
+
+Tds::Container * Cp3Parser::getOutermostClass()
+{
+    Tds::Namespace * ns = module.getCurrentNamespace();
+    Tds::Container * toret = NULL;
+
+    if ( module.getState() == Tds::Module::ClassLevel
+      && ns != NULL
+      && ns->getCurrentClass() != NULL )
+    {
+        toret = ns->getCurrentClass();
+
+        while( dynamic_cast<Tds::Class *>( toret->getContainer() ) != NULL ) {
+            toret = toret->getContainer();
+        }
+    }
+
+    return toret;
+}
+
+OutputBuffer * Cp3Parser::getInterfaceOutput(const std::string &name)
+/// @param name The name of the namespace member to write, if any
+{
+    OutputBuffer * toret = outputHeader;
+
+    if ( isPrivateContext() ) {
+        Tds::Container * owner = getOutermostClass();
+
+        // The members of a class belong to it
+        if ( owner == NULL
+          || privateEntities.empty()
+          || privateEntities.back().owner != owner )
+        {
+            PrivateEntity entity;
+
+            entity.name = ( owner != NULL ) ? owner->getName() : name;
+            entity.nsName = getQualifiedName( module.getCurrentNamespace() );
+            entity.owner = owner;
+            entity.position = outputHeader->getContents().length();
+            entity.begin = privateDecls.getContents().length();
+            privateEntities.push_back( entity );
+        }
+
+        toret = &privateDecls;
+    }
+
+    return toret;
+}
+
+void Cp3Parser::writePrivateEntities()
+{
+    const std::string &contents = privateDecls.getContents();
+    std::vector<std::string> texts;
+    std::vector<bool> inHeader( privateEntities.size(), false );
+    std::set<std::string> names;
+    std::string implDecls;
+    std::string nsName;
+    bool changed = true;
+
+    for(unsigned int i = 0; i < privateEntities.size(); ++i) {
+        const std::string::size_type end = ( i + 1 < privateEntities.size() ) ?
+                                                privateEntities[ i + 1 ].begin
+                                              : contents.length();
+
+        texts.push_back( contents.substr( privateEntities[ i ].begin, end - privateEntities[ i ].begin ) );
+    }
+
+    // The header needs the ones it refers to (in inline code, fields,
+    // prototypes or parents), and the ones these refer to
+    collectNames( outputHeader->getContents(), names );
+
+    while( changed ) {
+        changed = false;
+
+        for(unsigned int i = 0; i < privateEntities.size(); ++i) {
+            if ( !inHeader[ i ]
+              && names.find( privateEntities[ i ].name ) != names.end() )
+            {
+                inHeader[ i ] = changed = true;
+                collectNames( texts[ i ], names );
+            }
+        }
+    }
+
+    // Back to the header where they were, from the last one
+    // so the positions of the remaining ones are still valid
+    for(unsigned int i = privateEntities.size(); i > 0; --i) {
+        const PrivateEntity &entity = privateEntities[ i - 1 ];
+        const Tds::Module::Exports &exports = entity.exports;
+        const std::string text = removeLineInfo( texts[ i - 1 ] );
+
+        if ( !inHeader[ i - 1 ] ) {
+            continue;
+        }
+
+        outputHeader->insert( entity.position, text );
+
+        for(unsigned int j = 0; j < deferredImports.size(); ++j) {
+            if ( deferredImports[ j ].position > entity.position ) {
+                deferredImports[ j ].position += text.length();
+            }
+        }
+
+        for(Tds::Module::Exports::const_iterator it = exports.begin(); it != exports.end(); ++it) {
+            for(unsigned int j = 0; j < it->second.size(); ++j) {
+                module.addExport( it->first, it->second[ j ].kind, it->second[ j ].text );
+            }
+        }
+
+        if ( entity.owner != NULL ) {
+            module.addExportedClass( getQualifiedName( entity.owner ) );
+        }
+    }
+
+    // The rest to the implementation, inside their namespaces
+    for(unsigned int i = 0; i < privateEntities.size(); ++i) {
+        if ( !inHeader[ i ] ) {
+            implDecls += getNamespaceSwitch( nsName, privateEntities[ i ].nsName );
+            implDecls += texts[ i ];
+            nsName = privateEntities[ i ].nsName;
+        }
+    }
+
+    implDecls += getNamespaceSwitch( nsName, "" );
+    outputImpl->insert( implIncludesPosition, implDecls );
+}
+
+std::string Cp3Parser::getNamespaceSwitch(const std::string &from, const std::string &to)
+{
+    const std::string &access = Tds::Member::AccessOperator;
+    std::string::size_type pos = 0;
+    std::string::size_type posEnd;
+    std::string toret;
+
+    if ( from != to ) {
+        // Close the namespaces open
+        if ( !from.empty() ) {
+            for(pos = from.find( access ); pos != std::string::npos; pos = from.find( access, pos + access.length() )) {
+                toret += "} ";
+            }
+
+            toret += "} // namespace " + from + '\n';
+        }
+
+        // Open the new ones
+        if ( !to.empty() ) {
+            for(pos = 0; ( posEnd = to.find( access, pos ) ) != std::string::npos; pos = posEnd + access.length()) {
+                toret += Tds::Module::RWordNamespace + ' '
+                       + to.substr( pos, posEnd - pos )
+                       + ' ' + Tds::Method::OpenBrace + ' ';
+            }
+
+            toret += Tds::Module::RWordNamespace + ' '
+                   + to.substr( pos )
+                   + ' ' + Tds::Method::OpenBrace + '\n';
+        }
+    }
+
+    return toret;
+}
+
+std::string Cp3Parser::removeLineInfo(const std::string &text)
+{
+    std::istringstream in( text );
+    std::string line;
+    std::string toret;
+
+    while( std::getline( in, line ) ) {
+        if ( line.compare( 0, 6, "#line " ) != 0 ) {
+            toret += line + '\n';
+        }
+    }
+
+    return toret;
+}
+
+void Cp3Parser::addToInterface(Tds::Module::InterfaceKind kind, const std::string &text)
+{
+    Tds::Container * symbol = getOutermostClass();
+
+    // Members of classes are part of the interface of the outermost class
+    if ( symbol == NULL ) {
+        symbol = module.getCurrentNamespace();
+    }
+
+    if ( symbol != NULL ) {
+        addExport( getQualifiedName( symbol ), kind, text );
+    }
+}
+
+void Cp3Parser::addExport(const std::string &symbol, Tds::Module::InterfaceKind kind, const std::string &text)
+{
+    // Private declarations are only part of the interface if they stay in the header
+    if ( isPrivateContext() )
+            privateEntities.back().exports[ symbol ].push_back( Tds::Module::InterfaceText( kind, text ) );
+    else    module.addExport( symbol, kind, text );
+}
+
+unsigned int Cp3Parser::countStatements(const std::string &body, bool &hasLoops)
+{
+    static const char * LoopKeywords[] = { "for", "while", "do", "goto", "switch", "try", NULL };
+    unsigned int toret = 0;
+    unsigned int parenLevel = 0;
+    std::string word;
+
+    hasLoops = false;
+
+    for(std::string::size_type i = 0; i < body.length(); ++i) {
+        const char ch = body[ i ];
+
+        // Comments
+        if ( ch == '/'
+          && i + 1 < body.length() )
+        {
+            if ( body[ i + 1 ] == '/' ) {
+                i = body.find( '\n', i );
+                if ( i == std::string::npos ) {
+                    break;
+                }
+                continue;
+            }
+            else
+            if ( body[ i + 1 ] == '*' ) {
+                i = body.find( "*/", i + 2 );
+                if ( i == std::string::npos ) {
+                    break;
+                }
+                ++i;
+                continue;
+            }
+        }
+
+        // Literals
+        if ( ch == '"'
+          || ch == '\'' )
+        {
+            for(++i; i < body.length() && body[ i ] != ch; ++i) {
+                if ( body[ i ] == '\\' ) {
+                    ++i;
+                }
+            }
+            continue;
+        }
+
+        // Keywords
+        if ( std::isalpha( (unsigned char) ch )
+          || ch == '_' )
+        {
+            word.clear();
+            for(; i < body.length()
+               && ( std::isalnum( (unsigned char) body[ i ] ) || body[ i ] == '_' ); ++i)
+            {
+                word += body[ i ];
+            }
+            --i;
+
+            for(unsigned int j = 0; LoopKeywords[ j ] != NULL; ++j) {
+                if ( word == LoopKeywords[ j ] ) {
+                    hasLoops = true;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        // Statements (the ';' inside a for's parenthesis do not count)
+        if ( ch == '(' ) {
+            ++parenLevel;
+        }
+        else
+        if ( ch == ')'
+          && parenLevel > 0 )
+        {
+            --parenLevel;
+        }
+        else
+        if ( ch == Tds::Member::Semicolon[ 0 ]
+          && parenLevel == 0 )
+        {
+            ++toret;
+        }
+    }
+
+    return toret;
+}
+
+void Cp3Parser::applyInliningPolicy(Tds::Code &code, bool mayInline, bool isVirtual)
+/// Decides whether the code goes to the header or to the implementation,
+/// changing its storage, and records the decision
+{
+    bool hasLoops;
+    const unsigned int statements = countStatements( code.getBody(), hasLoops );
+    const bool wasInline = code.isInline();
+    bool inHeader = wasInline;
+
+    if ( wasInline ) {
+        // Large code only slows down the parsing of the header
+        if ( statements > maxStatementsKeptInline
+          || ( ( isVirtual || hasLoops ) && statements > maxStatementsInlined ) )
+        {
+            code.setStorage( NULL );
+            inHeader = false;
+        }
+    }
+    else
+    if ( mayInline
+      && code.getSystemStorage() == NULL
+      && !isVirtual
+      && !hasLoops
+      && statements <= maxStatementsInlined )
+    {
+        // Tiny code is worth being inlined in other modules
+        code.setStorage( &Tds::Member::InlineStorage );
+        inHeader = true;
+    }
+
+    placements.push_back(
+        Placement( code.getQualifiedName(), code.getLineNumber(), statements,
+                   inHeader, inHeader != wasInline )
+    );
+}
+
 void Cp3Parser::throwSyntaxError(const char * msg)
 {
     throw SyntaxError( msg, getNumLine() );
@@ -1278,14 +2854,80 @@ void Cp3Parser::saveToFile(const std::vector<std::string> &v, const std::string
     }
 }
 
-void Cp3Parser::updateNumLineInfo(FileLexer &lex, OutputFile *f)
+std::string Cp3Parser::getMakeRule(const std::vector<std::string> &targets) const
+{
+    const std::string &inputPath = inputFile->getFileName();
+    const std::string &headerPath = outputHeader->getFileName();
+    const Tds::Module::Dependencies &deps = module.getFileDependencies();
+    std::string dir;
+    std::string toret;
+
+    // Included files are relative to the directory of the header
+    std::string::size_type posDir = headerPath.rfind( '/' );
+    if ( posDir != std::string::npos ) {
+        dir = headerPath.substr( 0, posDir + 1 );
+    }
+
+    // Outputs
+    for(unsigned int i = 0; i < targets.size(); ++i) {
+        if ( i > 0 ) {
+            toret += ' ';
+        }
+
+        toret += escapeForMake( targets[ i ] );
+    }
+
+    // Inputs
+    toret += ": " + escapeForMake( inputPath );
+
+    for(unsigned int i = 0; i < deps.size(); ++i) {
+        toret += " \\\n  ";
+
+        if ( !deps[ i ].empty()
+          && deps[ i ][ 0 ] == '/' )
+        {
+            toret += escapeForMake( deps[ i ] );
+        }
+        else toret += escapeForMake( dir + deps[ i ] );
+    }
+
+    toret += '\n';
+    return toret;
+}
+
+std::string Cp3Parser::escapeForMake(const std::string &fileName)
 {
-    f->writeLn( getNumLineInfo( lex ) );
+    std::string toret;
+
+    for(unsigned int i = 0; i < fileName.length(); ++i) {
+        const char ch = fileName[ i ];
+
+        if ( ch == '$' ) {
+            toret += '$';
+        }
+        else
+        if ( ch == ' '
+          || ch == '#' )
+        {
+            toret += '\\';
+        }
+
+        toret += ch;
+    }
+
+    return toret;
+}
+
+void Cp3Parser::updateNumLineInfo(FileLexer &lex, OutputBuffer *f)
+{
+    if ( f->hasLineInfo() ) {
+        f->writeLn( getNumLineInfo( lex ) );
+    }
 }
 
 std::string Cp3Parser::getNumLineInfo(FileLexer &lex, unsigned int numLine)
 {
-    static std::string onlyFileName = FileMan::getFileName( lex.getFileName() );
+    const std::string onlyFileName = FileMan::getFileName( lex.getFileName() );
 
     if ( numLine == 0 ) {
         numLine = lex.getLineNumber();
@@ -1301,9 +2943,11 @@ std::string Cp3Parser::getNumLineInfo(FileLexer &lex, unsigned int numLine)
     return toret;
 }
 
-void Cp3Parser::writeNumLineInfo(OutputFile *f, FileLexer &lex, unsigned int l)
+void Cp3Parser::writeNumLineInfo(OutputBuffer *f, FileLexer &lex, unsigned int l)
 {
+    if ( f->hasLineInfo() ) {
         f->writeLn( getNumLineInfo( lex, l ) );
+    }
 }
 
 }
@@ -4,13 +4,20 @@
 #include "fileio.h"
 #include "lex.h"
 #include "cp3tds.h"
+#include "cp3output.h"
+#include "cp3layout.h"
 
 #include <vector>
 #include <string>
+#include <map>
+#include <set>
 #include <stdexcept>
 
 namespace Cp3mm {
 
+class ImportResolver;
+class ClassHierarchy;
+
 namespace Parser {
 
 /// Exceptions to be thrown by the parser
@@ -46,20 +53,197 @@ public:
         {}
 };
 
+/// Exceptions to be thrown for imports that cannot be found
+class ImportError : public ParserError {
+public:
+    /// Constructor for import errors
+    /// @param msg The string representing the message to show
+    /// @param n The line number in which the error appeared
+    ImportError(const char * msg, unsigned int n)
+        : ParserError( "Import error", msg, n )
+        {}
+};
+
 /// The parser itself
 class Cp3Parser {
+public:
+    /// An import whose #include is written once the whole module is known,
+    /// either in the header or only in the implementation
+    struct DeferredImport {
+        /// The header, as written in the #include
+        std::string header;
+
+        /// Where the #include goes in the header
+        std::string::size_type position;
+
+        /// Whether to include it in the header, or only in the implementation
+        bool inHeader;
+
+        /// The classes to forward declare in the header, when not included there
+        std::vector<std::string> classes;
+
+        DeferredImport(const std::string &h, std::string::size_type pos)
+            : header( h ), position( pos ), inHeader( true )
+            {}
+    };
+
+    /// The list of deferred imports
+    typedef std::vector<DeferredImport> DeferredImports;
+
+    /// Where the inlining policy placed the code of a function or method
+    struct Placement {
+        /// The qualified name of the function or method
+        std::string name;
+
+        /// The line in which it was found
+        unsigned int line;
+
+        /// The number of statements in its body
+        unsigned int statements;
+
+        /// Whether its code went to the header (inline), or to the implementation
+        bool inHeader;
+
+        /// Whether the policy changed the placement given by the inline storage
+        bool changed;
+
+        Placement(const std::string &n, unsigned int l, unsigned int s, bool h, bool c)
+            : name( n ), line( l ), statements( s ), inHeader( h ), changed( c )
+            {}
+    };
+
+    /// The list of placements, in order of appearance
+    typedef std::vector<Placement> Placements;
+
+    /// A data member (a static attribute or a constant) initialized at startup,
+    /// by running a constructor or evaluating an expression
+    struct DynamicInitializer {
+        /// The qualified name of the data member
+        std::string name;
+
+        /// The line in which it was found
+        unsigned int line;
+
+        /// What is run at startup to initialize it
+        std::string cost;
+
+        DynamicInitializer(const std::string &n, unsigned int l, const std::string &c)
+            : name( n ), line( l ), cost( c )
+            {}
+    };
+
+    /// The list of dynamic initializers, in order of appearance
+    typedef std::vector<DynamicInitializer> DynamicInitializers;
+
+    /// The estimated size of the fields of a class, before and after packing them,
+    /// and its budget
+    struct ClassLayout {
+        /// The qualified name of the class
+        std::string name;
+
+        /// The estimated size, with the fields in order of appearance
+        unsigned int sizeBefore;
+
+        /// The estimated size, with the fields as written
+        unsigned int sizeAfter;
+
+        /// The types of unknown size, taken as pointers
+        std::string unknownTypes;
+
+        /// Whether its fields were packed
+        bool packed;
+
+        /// The maximum size allowed, 0 if none
+        unsigned int budget;
+
+        /// Why its fields were kept in order of appearance, when it was asked
+        /// to pack them: a constructor initializing a field with another one
+        std::string dependency;
+
+        ClassLayout(const std::string &n, unsigned int b, unsigned int a,
+                    const std::string &u, bool p, unsigned int bg,
+                    const std::string &d = "")
+            : name( n ), sizeBefore( b ), sizeAfter( a ), unknownTypes( u ),
+              packed( p ), budget( bg ), dependency( d )
+            {}
+    };
+
+    /// The list of class layouts, in order of appearance
+    typedef std::vector<ClassLayout> ClassLayouts;
+
+    /// The list of warnings, in order of appearance
+    typedef std::vector<std::string> Warnings;
+
 private:
+    /// A declaration under private:, a class or a namespace member, written
+    /// in the implementation unless the header refers to it
+    struct PrivateEntity {
+        /// The name the header would refer to it by
+        std::string name;
+
+        /// The qualified name of the namespace it is inside of
+        std::string nsName;
+
+        /// The class, directly inside the namespace, NULL for other members
+        Tds::Container * owner;
+
+        /// Where it would be in the header
+        std::string::size_type position;
+
+        /// Where it starts, among the private declarations
+        std::string::size_type begin;
+
+        /// Its interface, exported if it stays in the header
+        Tds::Module::Exports exports;
+
+        PrivateEntity()
+            : owner( NULL ), position( 0 ), begin( 0 )
+            {}
+    };
+
+    /// The list of private entities, in order of appearance
+    typedef std::vector<PrivateEntity> PrivateEntities;
+
     std::auto_ptr<FileLexer> lex;
     InputFile  * inputFile;
-    OutputFile * outputHeader;
-    OutputFile * outputImpl;
+    OutputBuffer * outputHeader;
+    OutputBuffer * outputImpl;
     std::string onlyFileName;
+    std::string sourceDir;
+    ImportResolver * resolver;
+    std::string moduleDir;
+    bool deferImports;
+    DeferredImports deferredImports;
+    std::string::size_type implIncludesPosition;
+    bool privateInImpl;
+    OutputBuffer privateDecls;
+    PrivateEntities privateEntities;
+    bool inliningPolicy;
+    unsigned int maxStatementsInlined;
+    unsigned int maxStatementsKeptInline;
+    Placements placements;
+    bool constexprConstants;
+    bool inlineConstants;
+    std::map<std::string, bool> namespaceConstants;
+    bool charArrays;
+    DynamicInitializers dynamicInitializers;
+    const ClassHierarchy * hierarchy;
+    std::vector<Tds::Class *> headerClasses;
+    const FieldSizes * fieldSizes;
+    bool packFields;
+    const LayoutBudgets * layoutBudgets;
+    ClassLayouts classLayouts;
+    std::string layoutGuards;
+    Warnings warnings;
     Tds::Module module;
 
     void throwSyntaxError(const char *);
 
     void writePreambles();
     void writeColophons();
+    void writeClosedHierarchies();
+    std::string getClosedHierarchy(const ClassHierarchy &classes, Tds::Class &base);
+    static bool getArguments(const std::string &parameters, std::string &args);
 
     void processSpecialCharacter();
     void processEndings();
@@ -68,25 +252,176 @@ private:
     void processUsing();
     void processImport();
     void processTypedef();
-    void processClass();
+    void processClass(bool aligned = false);
+    void processAligned();
+    void processSection();
     void processNamespace();
     void processVisibility();
     void processComments();
-    void processClassMember();
+    void processClassMember(const std::string * firstModifier = NULL);
     void processField(Tds::Class &cl, Tds::Attribute &atr);
     void processMethod(Tds::Class &cl, Tds::Method &mth);
     void processNamespaceMember();
     void processRegularFunction(Tds::Function &);
     void processConstant(Tds::Constant &);
     void processQuickList(Tds::Method & mth);
+    void processLayout(Tds::Class &cl);
+    void writeLayoutGuards(Tds::Class &cl, const LayoutBudgets::Budget &budget);
+    void chkFalseSharing(Tds::Class &cl, const std::vector<Tds::Attribute *> &fields,
+                         const FieldSizes::Sizes &sizes = FieldSizes::Sizes(), unsigned int start = 0);
+    void writeMember(Tds::Member &member);
+    bool isPackedField(const Tds::Member &member) const;
+    bool isDeferredMember(const Tds::Member &member) const;
+    std::string findInitDependency(Tds::Class &cl, const std::vector<Tds::Attribute *> &fields);
+    static std::string sortInitializers(const std::string &list, const std::vector<Tds::Attribute *> &fields);
+    static void splitInitializers(const std::string &list, std::vector<std::string> &inits);
+    static std::string getInitializedName(const std::string &init);
+    static void collectNames(const std::string &code, std::set<std::string> &names, bool onlyOwn = false);
+
+    bool isPrivateContext();
+    Tds::Container * getOutermostClass();
+    OutputBuffer * getInterfaceOutput(const std::string &name = "");
+    void writePrivateEntities();
+    static std::string getNamespaceSwitch(const std::string &from, const std::string &to);
+    static std::string removeLineInfo(const std::string &text);
+    void addToInterface(Tds::Module::InterfaceKind kind, const std::string &text);
+    void addExport(const std::string &symbol, Tds::Module::InterfaceKind kind, const std::string &text);
+    void applyInliningPolicy(Tds::Code &code, bool mayInline, bool isVirtual);
+    static unsigned int countStatements(const std::string &body, bool &hasLoops);
+    bool isConstantExpression(const std::string &expr, const std::string &scope) const;
+    bool isCompileTimeConstant(const std::string &name, const std::string &scope) const;
+    static std::string getScopeOf(Tds::Member &member);
+    void processInitialization(Tds::Data &data);
+    static bool isStringLiteral(const std::string &expr, unsigned int &length);
+    static Tds::Module::InterfaceKind getInterfaceKind(const Tds::Member &member);
+    static std::string getQualifiedName(Tds::Container * cnt);
 
     std::string getId();
     std::string getReference();
     void skipDelimiter(const std::string &delim);
 public:
-    Cp3Parser(InputFile &, OutputFile &, OutputFile &, Tds::Entity::Strictness = Tds::Entity::MediumStrictness);
+    /// Creates a new parser. Output is kept in memory, until the caller saves it.
+    /// @param fin The module source file
+    /// @param foutH The buffer for the header
+    /// @param foutC The buffer for the implementation
+    /// @param levelChk The strictness level
+    /// @param moduleName The name of the module, taken from fin if empty
+    Cp3Parser(InputFile &fin, OutputBuffer &foutH, OutputBuffer &foutC,
+              Tds::Entity::Strictness levelChk = Tds::Entity::MediumStrictness,
+              const std::string &moduleName = "");
 
     void process();
+
+    /// Sets the path of the directory of the module, relative to the output directory.
+    /// It is prepended to quoted includes of files not generated by cp3,
+    /// so they can still be found when the output goes to a different directory.
+    /// @param dir The path of the directory, ending in '/'
+    void setSourceDir(const std::string &dir)
+        { sourceDir = dir; }
+
+    /// Sets the resolver to find imported modules with. Dependencies are then
+    /// stored as absolute paths, and imports not found are errors.
+    /// @param r The resolver, or NULL to take imports for granted
+    /// @param dir The directory of the module, where imports are looked for first,
+    ///            ending in '/' (empty for the current one, i.e. for standard input)
+    void setImportResolver(ImportResolver * r, const std::string &dir = "")
+        { resolver = r; moduleDir = dir; }
+
+    /// Makes imports to be written by writeDeferredImports(), after processing,
+    /// so they can be placed in the header or in the implementation
+    /// @param defer Whether to defer imports or not
+    void setDeferImports(bool defer)
+        { deferImports = defer; }
+
+    /// Makes private namespace members, and private classes in namespaces,
+    /// to be declared in the implementation instead of the header,
+    /// save for the ones the header refers to
+    /// @param inImpl Whether to move them to the implementation or not
+    void setPrivateInImpl(bool inImpl)
+        { privateInImpl = inImpl; }
+
+    /// Places the code of functions and methods depending on the size and shape
+    /// of their bodies, instead of only on the inline storage:
+    /// straight code with up to maxInlined statements goes to the header,
+    /// while inline code with more than maxKeptInline statements (or more than
+    /// maxInlined, when virtual or having loops) goes to the implementation.
+    /// @param maxInlined The maximum number of statements for code moved to the header
+    /// @param maxKeptInline The maximum number of statements for inline code kept in the header
+    void setInliningPolicy(unsigned int maxInlined, unsigned int maxKeptInline)
+        {
+            inliningPolicy = true;
+            maxStatementsInlined = maxInlined;
+            maxStatementsKeptInline = maxKeptInline;
+        }
+
+    /// Makes constants of native types initialized with constant expressions
+    /// (literals and other such constants) to be defined as constexpr in the header,
+    /// so their values are known when compiling the importing modules
+    /// @param inlineVars Whether to define them as inline variables (C++17)
+    void setConstexprConstants(bool inlineVars = false)
+        { constexprConstants = true; inlineConstants = inlineVars; }
+
+    /// Makes std::string static attributes and constants initialized with
+    /// string literals to be stored as const char arrays, needing no construction
+    void setCharArrays(bool arrays)
+        { charArrays = arrays; }
+
+    /// Sets the hierarchy of the classes of the program, making final the classes
+    /// and virtual methods sealed in it
+    /// @param h The hierarchy, or NULL to make nothing final
+    void setClassHierarchy(const ClassHierarchy * h)
+        { hierarchy = h; }
+
+    /// Sets the sizes of the types, for estimating the layout of classes
+    /// @param sizes The sizes of the types, or NULL to estimate nothing
+    void setFieldSizes(const FieldSizes * sizes)
+        { fieldSizes = sizes; }
+
+    /// Makes the private and protected fields of classes to be written at the end
+    /// of the class, sorted by alignment, so they need less padding.
+    /// Needs the sizes of the types.
+    void setPackFields(bool pack)
+        { packFields = pack; }
+
+    /// Sets the budgets for the layout of classes, checked with static assertions
+    /// in the implementation (for classes which can be named from outside).
+    /// Needs the sizes of the types, for reporting.
+    /// @param budgets The budgets, or NULL to check nothing
+    void setLayoutBudgets(const LayoutBudgets * budgets)
+        { layoutBudgets = budgets; }
+
+    /// Returns the estimated sizes of the classes with packed fields, or with a budget
+    const ClassLayouts &getClassLayouts() const
+        { return classLayouts; }
+
+    /// Returns the warnings found, which do not stop the generation
+    const Warnings &getWarnings() const
+        { return warnings; }
+
+    /// Returns the data members initialized at startup, running code
+    const DynamicInitializers &getDynamicInitializers() const
+        { return dynamicInitializers; }
+
+    /// Returns where the inlining policy placed each function and method
+    const Placements &getPlacements() const
+        { return placements; }
+
+    /// Returns the imports deferred, to decide where to place them
+    DeferredImports &getDeferredImports()
+        { return deferredImports; }
+
+    /// Writes the deferred imports, in the header or in the implementation,
+    /// with the forward declarations needed
+    void writeDeferredImports();
+
+    /// Returns the forward declaration of a class
+    /// @param className The qualified name of the class (i.e., Utils::Containers::Stack)
+    static std::string getForwardDeclaration(const std::string &className);
+
+    /// Returns the opening of a namespace, nested ones included
+    /// @param nsName The qualified name of the namespace (i.e., Utils::Containers)
+    /// @param closing The std::string in which to add the closing braces, as " }"
+    static std::string openNamespaces(const std::string &nsName, std::string &closing);
 
     const std::string &getCurrentLine() const
         { return lex->getLine(); }
@@ -99,16 +434,24 @@ public:
     const Tds::Module &getModule() const
         { return module; }
     bool isKeyword(const std::string &);
-    void updateNumLineInfo(OutputFile *f)
+    void updateNumLineInfo(OutputBuffer *f)
         { updateNumLineInfo( *lex, f ); }
 
     static void saveToFile(const std::vector<std::string> &v, const std::string &f);
     void saveDependenciesToFile(const std::string &f) const
         { saveToFile( module.getDependencies(), f ); }
 
-    static void updateNumLineInfo(FileLexer &lex, OutputFile *f);
+    /// Returns a Makefile rule (also valid as a Ninja depfile) stating that
+    /// the targets depend on the module and on the headers it includes
+    /// @param targets The generated files
+    std::string getMakeRule(const std::vector<std::string> &targets) const;
+
+    /// Escapes the characters with a special meaning for make (' ', '#', '$')
+    static std::string escapeForMake(const std::string &fileName);
+
+    static void updateNumLineInfo(FileLexer &lex, OutputBuffer *f);
     static std::string getNumLineInfo(FileLexer &lex, unsigned int numLine = 0);
-    static void writeNumLineInfo(OutputFile *f, FileLexer &lex, unsigned int l);
+    static void writeNumLineInfo(OutputBuffer *f, FileLexer &lex, unsigned int l);
     static std::string readBody(FileLexer &l);
 };
 
@@ -0,0 +1,102 @@
+// cp3pool.cpp
+/*
+    Implementation of the pool of threads running tasks in parallel
+*/
+
+#include "cp3pool.h"
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace Cp3mm {
+
+/// The tasks to run, shared among threads
+struct PoolJob {
+    WorkerPool::Task * task;
+    unsigned int numTasks;
+    unsigned int next;
+    bool ok;
+    std::string error;
+    pthread_mutex_t mutex;
+};
+
+static void * poolWorker(void * arg)
+{
+    PoolJob &job = *( (PoolJob *) arg );
+    unsigned int i;
+
+    for(;;) {
+        {
+            Lock lock( job.mutex );
+            i = job.next++;
+        }
+
+        if ( i >= job.numTasks ) {
+            break;
+        }
+
+        try {
+            if ( !job.task->run( i ) ) {
+                Lock lock( job.mutex );
+                job.ok = false;
+            }
+        } catch(const std::exception &e) {
+            Lock lock( job.mutex );
+
+            job.ok = false;
+            if ( job.error.empty() ) {
+                job.error = e.what();
+            }
+        }
+    }
+
+    return NULL;
+}
+
+bool WorkerPool::run(Task &task, unsigned int numTasks, unsigned int numThreads)
+{
+    std::vector<pthread_t> threads;
+    PoolJob job;
+
+    if ( numThreads == 0 ) {
+        long numProcessors = sysconf( _SC_NPROCESSORS_ONLN );
+        numThreads = ( numProcessors > 0 ) ? numProcessors : 1;
+    }
+
+    if ( numThreads > numTasks ) {
+        numThreads = numTasks;
+    }
+
+    job.task = &task;
+    job.numTasks = numTasks;
+    job.next = 0;
+    job.ok = true;
+    pthread_mutex_init( &job.mutex, NULL );
+
+    // The calling thread is one of the workers
+    for(unsigned int i = 1; i < numThreads; ++i) {
+        pthread_t thread;
+
+        if ( pthread_create( &thread, NULL, poolWorker, &job ) == 0 ) {
+            threads.push_back( thread );
+        }
+    }
+
+    poolWorker( &job );
+
+    for(unsigned int i = 0; i < threads.size(); ++i) {
+        pthread_join( threads[ i ], NULL );
+    }
+
+    pthread_mutex_destroy( &job.mutex );
+
+    if ( !job.error.empty() ) {
+        throw std::runtime_error( job.error );
+    }
+
+    return job.ok;
+}
+
+}
@@ -0,0 +1,57 @@
+#ifndef CP3POOL_H_INCLUDED
+#define CP3POOL_H_INCLUDED
+
+#include <pthread.h>
+
+namespace Cp3mm {
+
+/// Holds a mutex while in scope
+class Lock {
+public:
+    Lock(pthread_mutex_t &m)
+        : mutex( m )
+        { pthread_mutex_lock( &mutex ); }
+
+    ~Lock()
+        { pthread_mutex_unlock( &mutex ); }
+
+private:
+    Lock(const Lock &);
+    Lock &operator=(const Lock &);
+
+    pthread_mutex_t &mutex;
+};
+
+/**
+    Runs a set of tasks in parallel, in a number of threads (the calling
+    one included). Each thread takes the next pending task as soon as
+    it finishes the previous one, so tasks of different lengths are
+    shared evenly.
+*/
+class WorkerPool {
+public:
+    /// The work to do for each task, run from several threads at the same time
+    class Task {
+    public:
+        virtual ~Task()
+            {}
+
+        /// Does the task given by its index
+        /// @param i The index of the task
+        /// @return false if it failed
+        virtual bool run(unsigned int i) = 0;
+    };
+
+    /// Runs all tasks, returning when all of them are done
+    /// @param task The work to do for each task
+    /// @param numTasks The number of tasks, each one given to Task::run() by its index
+    /// @param numThreads The number of threads to use, as many as processors if 0
+    /// @return false if any of the tasks failed
+    /// @throw std::runtime_error with the message of the first task throwing
+    ///                           an exception, once all tasks are done
+    static bool run(Task &task, unsigned int numTasks, unsigned int numThreads = 0);
+};
+
+}
+
+#endif // CP3POOL_H_INCLUDED
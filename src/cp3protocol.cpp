@@ -0,0 +1,83 @@
+// cp3protocol.cpp
+/*
+    Implementation of the client/server protocol helpers
+*/
+
+#include "cp3protocol.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <unistd.h>
+
+namespace Cp3mm {
+
+const std::string Protocol::CmdCwd      = "cwd ";
+const std::string Protocol::CmdArg      = "arg ";
+const std::string Protocol::CmdShutdown = "shutdown";
+const std::string Protocol::ReplyExit   = "#exit ";
+
+std::string Protocol::getDefaultSocketPath()
+{
+    char buffer[ 64 ];
+
+    std::sprintf( buffer, "/tmp/cp3-%u.sock", (unsigned int) getuid() );
+    return buffer;
+}
+
+bool Protocol::readLine(int fd, std::string &line)
+{
+    bool toret = false;
+    char ch;
+    ssize_t numRead;
+
+    line.clear();
+
+    for(;;) {
+        numRead = read( fd, &ch, 1 );
+
+        if ( numRead < 0
+          && errno == EINTR )
+        {
+            continue;
+        }
+
+        if ( numRead <= 0 ) {
+            break;
+        }
+
+        if ( ch == '\n' ) {
+            toret = true;
+            break;
+        }
+
+        line += ch;
+    }
+
+    return toret;
+}
+
+bool Protocol::writeAll(int fd, const std::string &contents)
+{
+    const char * cursor = contents.c_str();
+    size_t remaining = contents.length();
+    ssize_t numWritten;
+
+    while( remaining > 0 ) {
+        numWritten = write( fd, cursor, remaining );
+
+        if ( numWritten < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+
+            break;
+        }
+
+        cursor += numWritten;
+        remaining -= numWritten;
+    }
+
+    return ( remaining == 0 );
+}
+
+}
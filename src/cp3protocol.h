@@ -0,0 +1,43 @@
+#ifndef CP3PROTOCOL_H_INCLUDED
+#define CP3PROTOCOL_H_INCLUDED
+
+#include <string>
+
+namespace Cp3mm {
+
+/**
+    The protocol spoken by cp3client and the cp3 server through a local socket.
+    The client sends one command per line:
+        cwd <dir>       The working directory of the client
+        arg <text>      One command-line argument, as it would be given to cp3
+        (empty line)    Run the command line
+        shutdown        Stop the server
+    The server answers with the very same messages cp3 would show,
+    followed by a line with the ReplyExit mark and the exit code.
+*/
+class Protocol {
+public:
+    static const std::string CmdCwd;
+    static const std::string CmdArg;
+    static const std::string CmdShutdown;
+    static const std::string ReplyExit;
+
+    /// Returns the socket path to use when none is given: /tmp/cp3-<uid>.sock
+    static std::string getDefaultSocketPath();
+
+    /// Reads a line from a socket, without the ending '\n'
+    /// @param fd The socket descriptor
+    /// @param line The string in which to store the line
+    /// @return false if the connection was closed before a full line was read
+    static bool readLine(int fd, std::string &line);
+
+    /// Writes all the contents in a socket, or in a file
+    /// @param fd The socket or file descriptor
+    /// @param contents The string to write
+    /// @return true if everything was written, false otherwise
+    static bool writeAll(int fd, const std::string &contents);
+};
+
+}
+
+#endif // CP3PROTOCOL_H_INCLUDED
@@ -0,0 +1,112 @@
+// cp3resolver.cpp
+/*
+    Implementation of the resolution of imports
+*/
+
+#include "cp3resolver.h"
+#include "appinfo.h"
+#include "fileman.h"
+
+#include <dirent.h>
+
+namespace Cp3mm {
+
+bool ImportResolver::resolve(const std::string &header, const std::string &moduleDir, std::string &path)
+{
+    bool toret = lookIn( moduleDir, header, path );
+
+    for(unsigned int i = 0; !toret && i < options.searchPaths.size(); ++i) {
+        toret = lookIn( options.searchPaths[ i ], header, path );
+    }
+
+    return toret;
+}
+
+bool ImportResolver::findModule(const std::string &header, const std::string &moduleDir, std::string &source)
+{
+    std::string absDir = Driver::getAbsoluteFileName( moduleDir.empty() ? "." : moduleDir ) + '/';
+    bool toret = findSource( absDir, header, source );
+
+    for(unsigned int i = 0; !toret && i < options.searchPaths.size(); ++i) {
+        absDir = Driver::getAbsoluteFileName( options.searchPaths[ i ] ) + '/';
+        toret = findSource( absDir, header, source );
+    }
+
+    if ( toret ) {
+        source = Driver::getRelativePath( ".", absDir ) + source;
+    }
+
+    return toret;
+}
+
+bool ImportResolver::findSource(const std::string &absDir, const std::string &header, std::string &source)
+{
+    const Listing &listing = getListing( absDir );
+    const std::string ** cursor = AppInfo::AcceptedExts;
+    bool toret = false;
+
+    for(; *cursor != NULL; ++cursor) {
+        source = FileMan::replaceExt( header, **cursor );
+
+        if ( listing.find( source ) != listing.end() ) {
+            toret = true;
+            break;
+        }
+    }
+
+    return toret;
+}
+
+bool ImportResolver::lookIn(const std::string &dir, const std::string &header, std::string &path)
+{
+    const std::string absDir = Driver::getAbsoluteFileName( dir.empty() ? "." : dir ) + '/';
+    const Listing &listing = getListing( absDir );
+    std::string source;
+    bool toret = false;
+
+    if ( listing.find( header ) != listing.end() ) {
+        path = absDir + header;
+        toret = true;
+    }
+    else
+    if ( findSource( absDir, header, source ) ) {
+        // The header is not generated yet
+        const std::string relDir = Driver::getRelativePath( ".", absDir );
+
+        path = Driver::getAbsoluteFileName(
+                Driver::getOutputName( options, relDir + source, AppInfo::CHeaderFilesExt ) );
+        toret = true;
+    }
+
+    return toret;
+}
+
+const ImportResolver::Listing &ImportResolver::getListing(const std::string &dir)
+{
+    std::map<std::string, Listing>::iterator it;
+
+    pthread_mutex_lock( &mutex );
+    it = listings.find( dir );
+
+    // Read the directory only the first time
+    if ( it == listings.end() ) {
+        DIR * d = opendir( dir.c_str() );
+        struct dirent * entry;
+
+        it = listings.insert( std::make_pair( dir, Listing() ) ).first;
+
+        if ( d != NULL ) {
+            while( ( entry = readdir( d ) ) != NULL ) {
+                it->second.insert( entry->d_name );
+            }
+
+            closedir( d );
+        }
+    }
+
+    // Listings are never modified once read
+    pthread_mutex_unlock( &mutex );
+    return it->second;
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef CP3RESOLVER_H_INCLUDED
+#define CP3RESOLVER_H_INCLUDED
+
+#include "cp3driver.h"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <pthread.h>
+
+namespace Cp3mm {
+
+/**
+    Finds the headers of imported modules, looking first in the directory
+    of the importing module, and then in the search paths (-I), in order.
+    A header is found if it exists, or if the module it is generated from does.
+    The contents of each directory are read only once, so each import
+    is resolved with a few lookups in memory.
+    Resolvers can be shared among threads.
+*/
+class ImportResolver {
+public:
+    /// Creates a new resolver
+    /// @param opts The options, holding the search paths and the output directory
+    ImportResolver(const Options &opts)
+        : options( opts )
+        { pthread_mutex_init( &mutex, NULL ); }
+
+    ~ImportResolver()
+        { pthread_mutex_destroy( &mutex ); }
+
+    /// Finds the header of an imported module
+    /// @param header The header, as imported (i.e., Utils.Math.h)
+    /// @param moduleDir The directory of the importing module
+    /// @param path The string in which to store the absolute path of the header
+    /// @return true if the header was found, false otherwise
+    bool resolve(const std::string &header, const std::string &moduleDir, std::string &path);
+
+    /// Finds the module a header is generated from
+    /// @param header The header, as imported or included (i.e., Utils.Math.h)
+    /// @param moduleDir The directory of the importing module
+    /// @param source The string in which to store the path of the module,
+    ///               relative to the current directory
+    /// @return true if the module was found, false otherwise
+    bool findModule(const std::string &header, const std::string &moduleDir, std::string &source);
+
+    /// Returns the search paths used
+    const std::vector<std::string> &getSearchPaths() const
+        { return options.searchPaths; }
+
+private:
+    /// The names of the files in a directory
+    typedef std::set<std::string> Listing;
+
+    const Listing &getListing(const std::string &dir);
+    bool lookIn(const std::string &dir, const std::string &header, std::string &path);
+    bool findSource(const std::string &absDir, const std::string &header, std::string &source);
+
+    Options options;
+    std::map<std::string, Listing> listings;
+    pthread_mutex_t mutex;
+};
+
+}
+
+#endif // CP3RESOLVER_H_INCLUDED
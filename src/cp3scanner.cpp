@@ -0,0 +1,266 @@
+// cp3scanner.cpp
+/*
+    Implementation of the quick scanner of modules
+*/
+
+#include "cp3scanner.h"
+#include "cp3driver.h"
+#include "cp3pool.h"
+#include "cp3tds.h"
+#include "appinfo.h"
+#include "fileman.h"
+
+#include <cctype>
+#include <stdexcept>
+
+namespace Cp3mm {
+
+namespace Parser {
+
+static inline bool isIdChar(char ch)
+{
+    return ( std::isalnum( (unsigned char) ch ) || ch == '_' );
+}
+
+/// Scans each of the modules in a list
+class ScanTask : public WorkerPool::Task {
+public:
+    ScanTask(std::vector<ModuleScanner> &s)
+        : scanners( s )
+        {}
+
+    bool run(unsigned int i)
+        { scanners[ i ].scan(); return true; }
+
+private:
+    std::vector<ModuleScanner> &scanners;
+};
+
+void ModuleScanner::scanAll(std::vector<ModuleScanner> &scanners, unsigned int numThreads)
+{
+    ScanTask task( scanners );
+
+    WorkerPool::run( task, scanners.size(), numThreads );
+}
+
+ModuleScanner::Headers ModuleScanner::getDependencies() const
+{
+    const std::string dir = Driver::getDirectory( fileName );
+    Headers toret;
+
+    toret.reserve( imports.size() + includes.size() );
+
+    for(unsigned int i = 0; i < imports.size(); ++i) {
+        toret.push_back( dir + imports[ i ] );
+    }
+
+    for(unsigned int i = 0; i < includes.size(); ++i) {
+        if ( !includes[ i ].empty()
+          && includes[ i ][ 0 ] == '/' )
+        {
+            toret.push_back( includes[ i ] );
+        }
+        else toret.push_back( dir + includes[ i ] );
+    }
+
+    return toret;
+}
+
+void ModuleScanner::scan()
+{
+    std::string contents;
+
+    if ( !Driver::readFile( fileName, contents ) ) {
+        throw std::runtime_error( "unable to read '" + fileName + '\'' );
+    }
+
+    scan( contents );
+}
+
+void ModuleScanner::scan(const std::string &contents)
+{
+    const char * p = contents.data();
+    const char * const end = p + contents.length();
+    const char * start;
+    bool atLineStart = true;
+    bool afterInt = false;
+    int nestingLevel = 0;
+    std::string word;
+
+    imports.clear();
+    includes.clear();
+    entryPoint = false;
+
+    while( p < end ) {
+        const char ch = *p;
+
+        // Blanks
+        if ( ch == '\n' ) {
+            atLineStart = true;
+            ++p;
+            continue;
+        }
+
+        if ( std::isspace( (unsigned char) ch ) ) {
+            ++p;
+            continue;
+        }
+
+        // Comments
+        if ( ch == '/'
+          && p + 1 < end )
+        {
+            if ( p[ 1 ] == '/' ) {
+                while( p < end && *p != '\n' ) {
+                    ++p;
+                }
+                continue;
+            }
+            else
+            if ( p[ 1 ] == '*' ) {
+                p += 2;
+                while( p + 1 < end
+                    && !( p[ 0 ] == '*' && p[ 1 ] == '/' ) )
+                {
+                    ++p;
+                }
+                p += 2;
+                continue;
+            }
+        }
+
+        // Literals
+        if ( ch == '"'
+          || ch == '\'' )
+        {
+            for(++p; p < end && *p != ch; ++p) {
+                if ( *p == '\\' ) {
+                    ++p;
+                }
+            }
+            ++p;
+            atLineStart = afterInt = false;
+            continue;
+        }
+
+        // Directives
+        if ( ch == '#'
+          && atLineStart )
+        {
+            ++p;
+            while( p < end && ( *p == ' ' || *p == '\t' ) ) {
+                ++p;
+            }
+
+            start = p;
+            while( p < end && isIdChar( *p ) ) {
+                ++p;
+            }
+
+            if ( nestingLevel == 0
+              && std::string( start, p ) == Tds::Module::RWordInclude )
+            {
+                while( p < end && ( *p == ' ' || *p == '\t' ) ) {
+                    ++p;
+                }
+
+                if ( p < end
+                  && *p == '"' )
+                {
+                    start = ++p;
+                    while( p < end && *p != '"' && *p != '\n' ) {
+                        ++p;
+                    }
+
+                    std::string iFileName( start, p );
+                    if ( FileMan::getExt( iFileName ) == AppInfo::Cp3FilesExt ) {
+                        FileMan::replaceExtCnvt( iFileName, AppInfo::CHeaderFilesExt );
+                    }
+
+                    includes.push_back( iFileName );
+                }
+            }
+
+            // Skip the remaining of the directive
+            while( p < end && *p != '\n' ) {
+                ++p;
+            }
+            continue;
+        }
+
+        atLineStart = false;
+
+        // Identifiers
+        if ( isIdChar( ch ) ) {
+            start = p;
+            while( p < end && isIdChar( *p ) ) {
+                ++p;
+            }
+
+            if ( nestingLevel > 0 ) {
+                continue;
+            }
+
+            word.assign( start, p );
+
+            if ( stopAtNamespace
+              && word == Tds::Module::RWordNamespace )
+            {
+                break;
+            }
+
+            if ( word == Tds::Module::RWordImport ) {
+                std::string reference;
+
+                // Read the module name, until the ';'
+                while( p < end && *p != Tds::Member::Semicolon[ 0 ] ) {
+                    if ( !std::isspace( (unsigned char) *p ) ) {
+                        reference += *p;
+                    }
+                    ++p;
+                }
+
+                if ( !reference.empty() ) {
+                    imports.push_back( reference + AppInfo::CHeaderFilesExt );
+                }
+            }
+            else
+            if ( afterInt
+              && word == Tds::Member::MainFunctionId )
+            {
+                const char * q = p;
+
+                while( q < end && std::isspace( (unsigned char) *q ) ) {
+                    ++q;
+                }
+
+                if ( q < end
+                  && *q == '(' )
+                {
+                    entryPoint = true;
+                }
+            }
+
+            afterInt = ( word == Tds::Member::IntType );
+            continue;
+        }
+
+        // Punctuation
+        if ( ch == '{' ) {
+            ++nestingLevel;
+        }
+        else
+        if ( ch == '}'
+          && nestingLevel > 0 )
+        {
+            --nestingLevel;
+        }
+
+        afterInt = false;
+        ++p;
+    }
+}
+
+}
+
+}
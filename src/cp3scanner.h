@@ -0,0 +1,77 @@
+#ifndef CP3SCANNER_H_INCLUDED
+#define CP3SCANNER_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+namespace Cp3mm {
+
+namespace Parser {
+
+/**
+    A quick scanner for modules, which does not parse them:
+    it only looks for the imports, the includes and the entry point,
+    skipping comments and literals, and keeping track of the nesting level.
+    It is meant for tools needing to know the relations among modules
+    (i.e., build files), which cannot afford a full parse of each one.
+    @see Cp3Parser
+*/
+class ModuleScanner {
+public:
+    /// The list of headers found
+    typedef std::vector<std::string> Headers;
+
+    /// Creates a new scanner for a given module
+    /// @param fn The file name of the module
+    /// @param onlyPrologue Stop at the first namespace, since imports and
+    ///                     includes come before. The entry point is not looked for.
+    ModuleScanner(const std::string &fn, bool onlyPrologue = false)
+        : fileName( fn ), stopAtNamespace( onlyPrologue ), entryPoint( false )
+        {}
+
+    /// Scans a set of modules, in parallel
+    /// @param scanners The scanners for each module
+    /// @param numThreads The number of threads to use, as many as processors if 0
+    /// @throw std::runtime_error if any of the modules cannot be read
+    static void scanAll(std::vector<ModuleScanner> &scanners, unsigned int numThreads = 0);
+
+    /// Scans the module
+    /// @throw std::runtime_error if the module cannot be read
+    void scan();
+
+    /// Scans the module, given its contents
+    /// @param contents The source code of the module
+    void scan(const std::string &contents);
+
+    /// Returns the file name of the module
+    const std::string &getFileName() const
+        { return fileName; }
+
+    /// Returns the headers for the imported modules (import X; -> X.h)
+    const Headers &getImports() const
+        { return imports; }
+
+    /// Returns the files included with #include "...", .cp3 files changed to .h
+    const Headers &getIncludes() const
+        { return includes; }
+
+    /// Returns the imported and included headers, relative to the current directory
+    Headers getDependencies() const;
+
+    /// Determines whether the module has an entry point (main() function)
+    bool hasEntryPoint() const
+        { return entryPoint; }
+
+private:
+    std::string fileName;
+    bool stopAtNamespace;
+    Headers imports;
+    Headers includes;
+    bool entryPoint;
+};
+
+}
+
+}
+
+#endif // CP3SCANNER_H_INCLUDED
@@ -0,0 +1,198 @@
+// cp3server.cpp
+/*
+    Implementation of the server (daemon) mode
+*/
+
+#include "cp3server.h"
+#include "appinfo.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace Cp3mm {
+
+Server::~Server()
+{
+    if ( listener >= 0 ) {
+        close( listener );
+        unlink( socketPath.c_str() );
+    }
+}
+
+void Server::open()
+{
+    struct sockaddr_un address;
+
+    if ( socketPath.length() >= sizeof( address.sun_path ) ) {
+        throw std::runtime_error( "socket path too long: " + socketPath );
+    }
+
+    listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( listener < 0 ) {
+        throw std::runtime_error( "unable to create socket" );
+    }
+
+    std::memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    std::strcpy( address.sun_path, socketPath.c_str() );
+
+    // A previous server could have left it behind
+    unlink( socketPath.c_str() );
+
+    if ( bind( listener, (struct sockaddr *) &address, sizeof( address ) ) != 0
+      || listen( listener, SOMAXCONN ) != 0 )
+    {
+        throw std::runtime_error( "unable to listen at '" + socketPath + '\'' );
+    }
+
+    // Clients hanging up must not kill the server
+    std::signal( SIGPIPE, SIG_IGN );
+}
+
+int Server::serve()
+{
+    int fd;
+
+    open();
+    driver.setKeepWarm();
+    std::fprintf( driver.getOutput(), "Listening at '%s'...\n", socketPath.c_str() );
+    std::fflush( driver.getOutput() );
+
+    while( !finished ) {
+        fd = accept( listener, NULL, NULL );
+
+        if ( fd < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+
+            throw std::runtime_error( "unable to accept connections" );
+        }
+
+        attend( fd );
+        close( fd );
+    }
+
+    std::fprintf( driver.getOutput(), "Shutdown.\n" );
+    return EXIT_SUCCESS;
+}
+
+void Server::attend(int fd)
+{
+    std::vector<std::string> args;
+    std::string cwd;
+    std::string line;
+    int exitCode;
+
+    while( Protocol::readLine( fd, line ) ) {
+        if ( line.empty() ) {
+            exitCode = execute( fd, cwd, args );
+            Protocol::writeAll( fd, Protocol::ReplyExit + char( '0' + exitCode ) + '\n' );
+            break;
+        }
+        else
+        if ( line == Protocol::CmdShutdown ) {
+            finished = true;
+            Protocol::writeAll( fd, Protocol::ReplyExit + char( '0' + EXIT_SUCCESS ) + '\n' );
+            break;
+        }
+        else
+        if ( line.compare( 0, Protocol::CmdCwd.length(), Protocol::CmdCwd ) == 0 ) {
+            cwd = line.substr( Protocol::CmdCwd.length() );
+        }
+        else
+        if ( line.compare( 0, Protocol::CmdArg.length(), Protocol::CmdArg ) == 0 ) {
+            args.push_back( line.substr( Protocol::CmdArg.length() ) );
+        }
+        else {
+            Protocol::writeAll( fd, "\nError: 'invalid request: " + line + "'\n" );
+            Protocol::writeAll( fd, Protocol::ReplyExit + char( '0' + EXIT_FAILURE ) + '\n' );
+            break;
+        }
+    }
+}
+
+int Server::execute(int fd, const std::string &cwd, const std::vector<std::string> &args)
+{
+    int toret = EXIT_FAILURE;
+    FILE * out = NULL;
+    FILE * oldOutput = driver.getOutput();
+    std::vector<const char *> argv;
+    char serverCwd[ 4096 ];
+    bool changedDir = false;
+    int fdOut = dup( fd );
+
+    if ( fdOut < 0
+      || ( out = fdopen( fdOut, "w" ) ) == NULL )
+    {
+        Protocol::writeAll( fd, "\nError: 'unable to answer'\n" );
+        goto End;
+    }
+
+    // Requests are relative to the working directory of the client
+    if ( !cwd.empty() ) {
+        if ( getcwd( serverCwd, sizeof( serverCwd ) ) == NULL
+          || chdir( cwd.c_str() ) != 0 )
+        {
+            std::fprintf( out, "\nError: 'unable to change to directory %s'\n", cwd.c_str() );
+            goto End;
+        }
+
+        changedDir = true;
+    }
+
+    // Build the command line
+    argv.push_back( AppInfo::Name.c_str() );
+    for(unsigned int i = 0; i < args.size(); ++i) {
+        argv.push_back( args[ i ].c_str() );
+    }
+    argv.push_back( NULL );
+
+    // Neither another server nor a watcher can be started from here.
+    // Wrong options are left for the driver to report.
+    try {
+        Options opts;
+
+        opts.process( argv.size() - 1, &argv[ 0 ] );
+
+        if ( opts.server
+          || opts.watch )
+        {
+            std::fprintf( out, "\nError: 'server already running'\n" );
+            goto End;
+        }
+    } catch(const std::exception &) {
+    }
+
+    // Run it
+    driver.setOutput( out );
+    toret = driver.run( argv.size() - 1, &argv[ 0 ] );
+    driver.setOutput( oldOutput );
+
+    End:
+    // Back to the directory of the server, for the next request
+    if ( changedDir
+      && chdir( serverCwd ) != 0 )
+    {
+        toret = EXIT_FAILURE;
+    }
+
+    if ( out != NULL ) {
+        std::fclose( out );
+    }
+    else
+    if ( fdOut >= 0 ) {
+        close( fdOut );
+    }
+
+    return toret;
+}
+
+}
@@ -0,0 +1,51 @@
+#ifndef CP3SERVER_H_INCLUDED
+#define CP3SERVER_H_INCLUDED
+
+#include "cp3driver.h"
+#include "cp3protocol.h"
+
+#include <string>
+
+namespace Cp3mm {
+
+/**
+    The server (daemon) mode of cp3.
+    It listens on a local (Unix) socket for requests from cp3client,
+    running them with the same driver the command line uses.
+    The driver is kept alive between requests, so tables are initialized only once
+    and modules already generated and not modified are not processed again.
+    @see Protocol, Driver
+*/
+class Server {
+public:
+    /// Creates a new server
+    /// @param d The driver to run requests with
+    /// @param path The path of the local socket to listen on
+    Server(Driver &d, const std::string &path)
+        : driver( d ), socketPath( path ), listener( -1 ), finished( false )
+        {}
+
+    ~Server();
+
+    /// Attends requests until a shutdown command arrives
+    /// @return EXIT_SUCCESS or EXIT_FAILURE
+    int serve();
+
+    /// Returns the path of the local socket
+    const std::string &getSocketPath() const
+        { return socketPath; }
+
+private:
+    void open();
+    void attend(int fd);
+    int execute(int fd, const std::string &cwd, const std::vector<std::string> &args);
+
+    Driver &driver;
+    std::string socketPath;
+    int listener;
+    bool finished;
+};
+
+}
+
+#endif // CP3SERVER_H_INCLUDED
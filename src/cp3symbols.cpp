@@ -0,0 +1,610 @@
+// cp3symbols.cpp
+/*
+    Implementation of the tracking of symbols among modules
+*/
+
+#include "cp3symbols.h"
+#include "cp3driver.h"
+#include "cp3tds.h"
+
+#include <cctype>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+namespace Cp3mm {
+
+static const std::string ImportTag = "import";
+static const std::string ExportTag = "export";
+static const std::string UseTag    = "use";
+static const std::string ClassTag  = "class";
+static const std::string StdNamespace = "std";
+
+static inline bool isIdChar(char ch)
+{
+    return ( std::isalnum( (unsigned char) ch ) || ch == '_' );
+}
+
+static std::string toHex(uint64_t value)
+{
+    char buffer[ 17 ];
+
+    std::sprintf( buffer, "%016llx", (unsigned long long) value );
+    return buffer;
+}
+
+static uint64_t fromHex(const std::string &hex)
+{
+    unsigned long long toret = 0;
+
+    std::sscanf( hex.c_str(), "%llx", &toret );
+    return toret;
+}
+
+static void writeSymbols(std::string &contents, const std::string &tag, const SymbolFile::Symbols &symbols)
+{
+    for(SymbolFile::Symbols::const_iterator it = symbols.begin(); it != symbols.end(); ++it) {
+        contents += tag + ' ' + it->first + ' ' + toHex( it->second ) + '\n';
+    }
+}
+
+/// Determines whether a name belongs to the standard library
+static bool isStandard(const std::string &name)
+{
+    const std::string &access = Tds::Member::AccessOperator;
+
+    return ( name == StdNamespace
+          || name.compare( 0, StdNamespace.length() + access.length(), StdNamespace + access ) == 0 );
+}
+
+void SymbolFile::addUse(const std::string &name)
+{
+    if ( !isExported( name ) ) {
+        uses.insert( Symbols::value_type( name, 0 ) );
+    }
+}
+
+/// Splits code in names, qualified or not, and punctuation,
+/// skipping blanks, comments, directives and literals
+class CodeScanner {
+public:
+    CodeScanner(const std::string &code)
+        : p( code.data() ), end( code.data() + code.length() ), atLineStart( true )
+        {}
+
+    /// Moves to the next token
+    /// @param name The name found, empty for punctuation and literals
+    /// @param isQualified Whether the name has several components (A::B)
+    /// @return The first character of the token, 0 at the end
+    char next(std::string &name, bool &isQualified);
+
+    /// Returns the first character of the next token, without moving to it
+    char peek()
+        { skipBlanks(); return ( p < end ) ? *p : 0; }
+
+private:
+    void skipBlanks();
+
+    const char * p;
+    const char * end;
+    bool atLineStart;
+};
+
+void CodeScanner::skipBlanks()
+{
+    while( p < end ) {
+        if ( *p == '\n' ) {
+            atLineStart = true;
+            ++p;
+        }
+        else
+        if ( std::isspace( (unsigned char) *p ) ) {
+            ++p;
+        }
+        else
+        // Comments
+        if ( *p == '/'
+          && p + 1 < end
+          && p[ 1 ] == '/' )
+        {
+            while( p < end && *p != '\n' ) {
+                ++p;
+            }
+        }
+        else
+        if ( *p == '/'
+          && p + 1 < end
+          && p[ 1 ] == '*' )
+        {
+            p += 2;
+            while( p + 1 < end
+                && !( p[ 0 ] == '*' && p[ 1 ] == '/' ) )
+            {
+                ++p;
+            }
+            p += 2;
+        }
+        else
+        // Directives (#line, #include...)
+        if ( *p == '#'
+          && atLineStart )
+        {
+            while( p < end && *p != '\n' ) {
+                ++p;
+            }
+        }
+        else break;
+    }
+}
+
+char CodeScanner::next(std::string &name, bool &isQualified)
+{
+    char toret = 0;
+
+    name.clear();
+    isQualified = false;
+    skipBlanks();
+
+    if ( p < end ) {
+        toret = *p;
+        atLineStart = false;
+
+        // Literals
+        if ( toret == '"'
+          || toret == '\'' )
+        {
+            for(++p; p < end && *p != toret; ++p) {
+                if ( *p == '\\' ) {
+                    ++p;
+                }
+            }
+            ++p;
+        }
+        else
+        // Names, qualified or not
+        if ( isIdChar( toret )
+          && !std::isdigit( (unsigned char) toret ) )
+        {
+            for(;;) {
+                const char * start = p;
+
+                while( p < end && isIdChar( *p ) ) {
+                    ++p;
+                }
+
+                name.append( start, p );
+
+                if ( p + 2 < end
+                  && p[ 0 ] == ':'
+                  && p[ 1 ] == ':'
+                  && isIdChar( p[ 2 ] ) )
+                {
+                    name += Tds::Member::AccessOperator;
+                    p += 2;
+                    isQualified = true;
+                }
+                else break;
+            }
+        }
+        else
+        if ( isIdChar( toret ) ) {
+            // Numbers
+            while( p < end && isIdChar( *p ) ) {
+                ++p;
+            }
+        }
+        else ++p;
+    }
+
+    return toret;
+}
+
+void SymbolFile::collectUses(const std::string &code)
+{
+    const std::string &access = Tds::Member::AccessOperator;
+    CodeScanner scanner( code );
+    std::vector<std::string> namespaces;
+    std::vector<int> namespaceLevels;
+    std::string pendingNamespace;
+    bool afterUsing = false;
+    bool afterNamespace = false;
+    bool isQualified;
+    int nestingLevel = 0;
+    std::string name;
+    char ch;
+
+    while( ( ch = scanner.next( name, isQualified ) ) != 0 ) {
+        if ( !name.empty() ) {
+            if ( afterNamespace
+              && !afterUsing )
+            {
+                // Opening a namespace: unqualified names inside can refer to any level
+                pendingNamespace = namespaces.empty() ? name : namespaces.back() + access + name;
+            }
+            else
+            if ( ( isQualified
+                || afterNamespace )
+              && !isStandard( name ) )
+            {
+                // The name can be relative to any of the enclosing namespaces
+                addUse( name );
+
+                for(unsigned int i = 0; i < namespaces.size(); ++i) {
+                    addUse( namespaces[ i ] + access + name );
+                }
+
+                // Namespaces opened with "using namespace"
+                if ( afterNamespace ) {
+                    usings.insert( name );
+
+                    for(unsigned int i = 0; i < namespaces.size(); ++i) {
+                        usings.insert( namespaces[ i ] + access + name );
+                    }
+                }
+            }
+
+            afterUsing = ( name == Tds::Module::RWordUsing
+                        || ( afterUsing && name == Tds::Module::RWordNamespace ) );
+            afterNamespace = ( name == Tds::Module::RWordNamespace );
+            continue;
+        }
+
+        // Nesting
+        if ( ch == '{' ) {
+            ++nestingLevel;
+
+            if ( !pendingNamespace.empty() ) {
+                namespaces.push_back( pendingNamespace );
+                namespaceLevels.push_back( nestingLevel );
+                addUse( pendingNamespace );
+                pendingNamespace.clear();
+            }
+        }
+        else
+        if ( ch == '}' ) {
+            if ( !namespaceLevels.empty()
+              && namespaceLevels.back() == nestingLevel )
+            {
+                namespaces.pop_back();
+                namespaceLevels.pop_back();
+            }
+
+            --nestingLevel;
+        }
+
+        afterUsing = afterNamespace = false;
+    }
+}
+
+void SymbolFile::addExports(const Tds::Module &module)
+{
+    const Tds::Module::Exports &moduleExports = module.getExports();
+    const Tds::Module::Names &moduleClasses = module.getExportedClasses();
+
+    for(Tds::Module::Exports::const_iterator it = moduleExports.begin(); it != moduleExports.end(); ++it) {
+        std::set<std::string> &names = exportNames[ it->first ];
+        std::string text;
+        std::string name;
+        bool isQualified;
+
+        for(unsigned int i = 0; i < it->second.size(); ++i) {
+            CodeScanner scanner( it->second[ i ].text );
+
+            text += it->second[ i ].text;
+
+            // The names in its interface, which may be of imported symbols
+            while( scanner.next( name, isQualified ) != 0 ) {
+                if ( !name.empty()
+                  && !isStandard( name ) )
+                {
+                    names.insert( name );
+                }
+            }
+        }
+
+        exports[ it->first ] = Driver::hash( text );
+    }
+
+    classes.insert( moduleClasses.begin(), moduleClasses.end() );
+}
+
+void SymbolFile::findUsage(const Tds::Module &importer, const std::string &implCode, Usage &usage) const
+{
+    const std::string &access = Tds::Member::AccessOperator;
+    const Tds::Module::Exports &importerExports = importer.getExports();
+    std::vector<std::string> scopes;
+    bool isQualified;
+    std::string name;
+
+    usage = Usage();
+
+    // The header: the interface of each symbol exported by the importer
+    for(Tds::Module::Exports::const_iterator it = importerExports.begin(); it != importerExports.end(); ++it) {
+        // Names can be relative to any of the namespaces (or classes) the symbol is inside of
+        scopes.clear();
+        for(std::string::size_type pos = it->first.find( access );
+            pos != std::string::npos;
+            pos = it->first.find( access, pos + access.length() ))
+        {
+            scopes.push_back( it->first.substr( 0, pos ) + access );
+        }
+        scopes.push_back( it->first + access );
+
+        // Inline code can use what is held by pointer without naming it, so nothing is enough
+        bool hasInlineCode = false;
+        for(unsigned int i = 0; i < it->second.size(); ++i) {
+            hasInlineCode = hasInlineCode || ( it->second[ i ].kind == Tds::Module::InlineText );
+        }
+
+        for(unsigned int i = 0; i < it->second.size(); ++i) {
+            const Tds::Module::InterfaceText &piece = it->second[ i ];
+            CodeScanner scanner( piece.text );
+
+            while( scanner.next( name, isQualified ) != 0 ) {
+                if ( name.empty()
+                  || isStandard( name ) )
+                {
+                    continue;
+                }
+
+                std::string used;
+
+                if ( isExported( name ) ) {
+                    used = name;
+                } else {
+                    for(unsigned int j = 0; j < scopes.size(); ++j) {
+                        if ( isExported( scopes[ j ] + name ) ) {
+                            used = scopes[ j ] + name;
+                            break;
+                        }
+                    }
+                }
+
+                if ( used.empty() ) {
+                    continue;
+                }
+
+                // Classes can be forward declared for prototypes, or when held by pointer or reference
+                const bool isClass = ( classes.find( used ) != classes.end() );
+                const char nextCh = scanner.peek();
+                bool isIncomplete = false;
+
+                switch( piece.kind ) {
+                    case Tds::Module::DeclarationText:
+                        usage.inDeclarations = true;
+                        isIncomplete = ( isClass && ( nextCh == '*' || nextCh == '&' ) );
+                        break;
+                    case Tds::Module::DataText:
+                        usage.inData = true;
+                        isIncomplete = ( isClass && ( nextCh == '*' || nextCh == '&' ) );
+                        break;
+                    case Tds::Module::SignatureText:
+                        usage.inSignatures = true;
+                        isIncomplete = isClass;
+                        break;
+                    case Tds::Module::InlineText:
+                        usage.inInlineCode = true;
+                        break;
+                }
+
+                if ( isIncomplete
+                  && !hasInlineCode )
+                {
+                    usage.forwardDeclarable.insert( used );
+                }
+                else usage.needed.insert( used );
+            }
+        }
+    }
+
+    // The implementation: out-of-line bodies
+    SymbolFile bodies( "" );
+    bodies.collectUses( implCode );
+
+    for(Symbols::const_iterator it = bodies.uses.begin(); it != bodies.uses.end(); ++it) {
+        if ( isExported( it->first ) ) {
+            usage.inBodies = true;
+            break;
+        }
+    }
+}
+
+bool SymbolFile::isExported(const std::string &name) const
+{
+    const std::string &access = Tds::Member::AccessOperator;
+    std::string::size_type pos = 0;
+    bool toret = false;
+
+    // The name itself, or any of the classes (or namespaces) it is inside of
+    while( !toret ) {
+        pos = name.find( access, pos );
+        toret = ( exports.find( name.substr( 0, pos ) ) != exports.end() );
+
+        if ( pos == std::string::npos ) {
+            break;
+        }
+
+        pos += access.length();
+    }
+
+    return toret;
+}
+
+uint64_t SymbolFile::getHashOf(const std::string &name) const
+{
+    const std::string &access = Tds::Member::AccessOperator;
+    const std::string prefix = name + access;
+    std::string::size_type pos = 0;
+    std::string matches;
+
+    // The symbol itself, or the class containing it
+    for(;;) {
+        pos = name.find( access, pos );
+
+        Symbols::const_iterator it = exports.find( name.substr( 0, pos ) );
+        if ( it != exports.end() ) {
+            matches += it->first + ' ' + toHex( it->second ) + '\n';
+        }
+
+        if ( pos == std::string::npos ) {
+            break;
+        }
+
+        pos += access.length();
+    }
+
+    // All the symbols inside it, for namespaces
+    for(Symbols::const_iterator it = exports.lower_bound( prefix );
+        it != exports.end() && it->first.compare( 0, prefix.length(), prefix ) == 0;
+        ++it)
+    {
+        matches += it->first + ' ' + toHex( it->second ) + '\n';
+    }
+
+    return matches.empty() ? 0 : Driver::hash( matches );
+}
+
+void SymbolFile::addImport(const SymbolFile &imported)
+{
+    const std::string &access = Tds::Member::AccessOperator;
+
+    imports.push_back( imported.getFileName() );
+
+    for(Symbols::iterator it = uses.begin(); it != uses.end(); ++it) {
+        it->second += imported.getHashOf( it->first );
+    }
+
+    // The hash of each export covers the imported symbols in its interface,
+    // so the modules using it are stale when those change as well
+    for(std::map<std::string, std::set<std::string> >::const_iterator it = exportNames.begin(); it != exportNames.end(); ++it) {
+        std::vector<std::string> scopes;
+        std::string folded;
+
+        // Names can be relative to any of the namespaces (or classes) the symbol is inside of,
+        // or to the namespaces opened with "using namespace"
+        scopes.push_back( "" );
+        for(std::string::size_type pos = it->first.find( access );
+            pos != std::string::npos;
+            pos = it->first.find( access, pos + access.length() ))
+        {
+            scopes.push_back( it->first.substr( 0, pos ) + access );
+        }
+
+        for(std::set<std::string>::const_iterator itUsing = usings.begin(); itUsing != usings.end(); ++itUsing) {
+            scopes.push_back( *itUsing + access );
+        }
+
+        for(std::set<std::string>::const_iterator itName = it->second.begin(); itName != it->second.end(); ++itName) {
+            for(unsigned int i = 0; i < scopes.size(); ++i) {
+                const std::string name = scopes[ i ] + *itName;
+                const uint64_t hash = isExported( name ) ? 0 : imported.getHashOf( name );
+
+                if ( hash != 0 ) {
+                    folded += name + ' ' + toHex( hash ) + '\n';
+                }
+            }
+        }
+
+        if ( !folded.empty() ) {
+            uint64_t &hash = exports[ it->first ];
+
+            hash = Driver::hash( toHex( hash ) + '\n' + folded );
+        }
+    }
+}
+
+bool SymbolFile::isStale(std::string &reason) const
+{
+    std::vector<SymbolFile> current;
+    bool toret = false;
+
+    for(unsigned int i = 0; i < imports.size(); ++i) {
+        current.push_back( SymbolFile( imports[ i ] ) );
+
+        if ( !current.back().load() ) {
+            reason = imports[ i ];
+            toret = true;
+            goto End;
+        }
+    }
+
+    for(Symbols::const_iterator it = uses.begin(); it != uses.end(); ++it) {
+        uint64_t currentHash = 0;
+
+        for(unsigned int i = 0; i < current.size(); ++i) {
+            currentHash += current[ i ].getHashOf( it->first );
+        }
+
+        if ( currentHash != it->second ) {
+            reason = it->first;
+            toret = true;
+            break;
+        }
+    }
+
+    End:
+    return toret;
+}
+
+bool SymbolFile::load()
+{
+    std::string contents;
+    std::string line;
+    bool toret = Driver::readFile( fileName, contents );
+
+    imports.clear();
+    classes.clear();
+    exports.clear();
+    uses.clear();
+
+    if ( toret ) {
+        std::istringstream in( contents );
+
+        while( std::getline( in, line ) ) {
+            std::istringstream fields( line );
+            std::string tag;
+            std::string name;
+            std::string hash;
+
+            fields >> tag >> name >> hash;
+
+            if ( tag == ImportTag ) {
+                imports.push_back( line.substr( ImportTag.length() + 1 ) );
+            }
+            else
+            if ( tag == ClassTag ) {
+                classes.insert( name );
+            }
+            else
+            if ( tag == ExportTag ) {
+                exports[ name ] = fromHex( hash );
+            }
+            else
+            if ( tag == UseTag ) {
+                uses[ name ] = fromHex( hash );
+            }
+        }
+    }
+
+    return toret;
+}
+
+void SymbolFile::save() const
+{
+    std::string contents;
+
+    for(unsigned int i = 0; i < imports.size(); ++i) {
+        contents += ImportTag + ' ' + imports[ i ] + '\n';
+    }
+
+    for(std::set<std::string>::const_iterator it = classes.begin(); it != classes.end(); ++it) {
+        contents += ClassTag + ' ' + *it + '\n';
+    }
+
+    writeSymbols( contents, ExportTag, exports );
+    writeSymbols( contents, UseTag, uses );
+
+    Driver::writeFile( fileName, contents );
+}
+
+}
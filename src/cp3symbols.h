@@ -0,0 +1,148 @@
+#ifndef CP3SYMBOLS_H_INCLUDED
+#define CP3SYMBOLS_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <stdint.h>
+
+namespace Cp3mm {
+
+namespace Tds {
+    class Module;
+}
+
+/**
+    The symbols a module exports and the symbols of imported modules it uses,
+    stored in a text file (.sym) next to its header.
+    Each exported symbol (a function, a constant or a whole class) has a hash
+    of its interface, covering the hashes of the imported symbols named in it,
+    so changes are passed along chains of imports. Each used symbol (a qualified name found in signatures
+    and bodies, i.e., Math::removePercentage) is stored with the hash it had
+    in the imported module when the module was generated.
+    A module only needs to be recompiled after an imported module changes
+    if the hash of any of the symbols it uses changed.
+    The file is made of lines:
+        import  <file name of the .sym file of an imported module>
+        class   <qualified name of an exported class, directly inside a namespace>
+        export  <qualified name> <hash>
+        use     <qualified name> <hash>
+*/
+class SymbolFile {
+public:
+    /// The hashes, by qualified name
+    typedef std::map<std::string, uint64_t> Symbols;
+
+    /// Where a module uses the symbols of a module it imports
+    struct Usage {
+        /// In class declarations (i.e., parents) or typedefs
+        bool inDeclarations;
+        /// In the types of attributes and constants
+        bool inData;
+        /// In the prototypes of functions and methods
+        bool inSignatures;
+        /// In inline code, in the header
+        bool inInlineCode;
+        /// In out-of-line code, in the implementation
+        bool inBodies;
+        /// The classes used in the header in ways a forward declaration is enough for:
+        /// in prototypes, or held by pointer or reference
+        std::set<std::string> forwardDeclarable;
+        /// The symbols used in the header in ways needing their definitions
+        std::set<std::string> needed;
+
+        Usage()
+            : inDeclarations( false ), inData( false ), inSignatures( false ),
+              inInlineCode( false ), inBodies( false )
+            {}
+
+        /// Determines whether the header uses the symbols at all
+        bool isUsedInHeader() const
+            { return ( !forwardDeclarable.empty() || !needed.empty() ); }
+    };
+
+    /// Creates an empty set of symbols, for a given file
+    /// @param fn The name of the .sym file
+    SymbolFile(const std::string &fn)
+        : fileName( fn )
+        {}
+
+    /// Adds the symbols exported by a module, and its classes
+    /// @param module The module, once parsed
+    void addExports(const Tds::Module &module);
+
+    /// Adds the symbols of imported modules a module uses, given its code:
+    /// qualified names (A::B), namespaces opened with "using namespace",
+    /// and the namespaces the code is inside of, since their members can be
+    /// used unqualified. Names inside namespaces are taken as relative to each of them.
+    /// Names of the standard library and symbols exported are not taken into account.
+    /// @param code The generated code for the module
+    void collectUses(const std::string &code);
+
+    /// Adds an imported module, once exports and uses are added
+    /// @param imported The symbols of the imported module, for which
+    ///                 the current hash of each used symbol is stored,
+    ///                 and folded into the hashes of the exports naming it
+    void addImport(const SymbolFile &imported);
+
+    /// Returns the hash of a used symbol, as exported in this module.
+    /// Uses of a namespace cover all of the symbols inside it,
+    /// while uses of a class member are covered by the class itself.
+    /// @param name The qualified name of the used symbol
+    /// @return The hash, or 0 if this module does not export the symbol
+    uint64_t getHashOf(const std::string &name) const;
+
+    /// Finds where a module importing this one uses its symbols
+    /// @param importer The importing module, once parsed
+    /// @param implCode The generated implementation of the importing module
+    /// @param usage The Usage object in which to store the results
+    void findUsage(const Tds::Module &importer, const std::string &implCode, Usage &usage) const;
+
+    /// Determines whether any of the symbols used changed in the imported modules
+    /// @param reason The string in which to store the symbol (or module) that changed
+    /// @return true if the module must be recompiled, false otherwise
+    bool isStale(std::string &reason) const;
+
+    /// Loads the symbols from the file
+    /// @return true if the file could be read, false otherwise
+    bool load();
+
+    /// Saves the symbols to the file
+    /// @throw std::runtime_error if the file cannot be written
+    void save() const;
+
+    /// Returns the name of the file
+    const std::string &getFileName() const
+        { return fileName; }
+
+    /// Returns the symbols exported, with their hashes
+    const Symbols &getExports() const
+        { return exports; }
+
+    /// Returns the symbols used, with their hashes when the module was generated
+    const Symbols &getUses() const
+        { return uses; }
+
+    /// Returns the .sym files of the imported modules
+    const std::vector<std::string> &getImports() const
+        { return imports; }
+
+private:
+    void addUse(const std::string &name);
+
+    /// Determines whether a name is exported here, or inside an exported symbol
+    bool isExported(const std::string &name) const;
+
+    std::string fileName;
+    std::vector<std::string> imports;
+    std::set<std::string> classes;
+    Symbols exports;
+    Symbols uses;
+    std::map<std::string, std::set<std::string> > exportNames;
+    std::set<std::string> usings;
+};
+
+}
+
+#endif // CP3SYMBOLS_H_INCLUDED
@@ -8,6 +8,7 @@
 
 #include <stdexcept>
 #include <stack>
+#include <cctype>
 
 #include <iostream>
 void chkTellMe(const char *str)
@@ -29,7 +30,10 @@ const std::string Module::RWordInclude   = "include";
 const std::string Module::RWordImport    = "import";
 const std::string Module::RWordUsing     = "using";
 const std::string Module::RWordClass     = "class";
+const std::string Module::RWordClosed    = "closed";
 const std::string Module::RWordExtern    = "extern";
+const std::string Module::RWordConstexpr = "constexpr";
+const std::string Module::RWordFinal     = "final";
 const std::string Module::RWordNamespace = "namespace";
 const std::string Module::RWordTypedef   = "typedef";
 const std::string Module::ModulePrefix   = "__MODULE__";
@@ -47,10 +51,11 @@ const std::string Member::MdfConst       = "const";
 const std::string Member::MdfVirtual     = "virtual";
 const std::string Member::MdfUnsigned    = "unsigned";
 const std::string Member::MdfExplicit    = "explicit";
+const std::string Member::MdfAligned     = "aligned";
 const std::string Member::MdfIsPointer   = "*";
 const std::string Member::MdfIsReference = "&";
 const std::string * Member::Modifier[] = {
-        &MdfVirtual, &MdfConst, &MdfUnsigned, &MdfExplicit,
+        &MdfVirtual, &MdfConst, &MdfUnsigned, &MdfExplicit, &MdfAligned,
         &MdfIsPointer, &MdfIsReference, NULL
 };
 
@@ -68,12 +73,21 @@ const std::string Member::InlineStorage = "inline";
 const std::string Member::VolatileStorage = "volatile";
 const std::string Member::AutoStorage = "auto";
 const std::string Member::FriendStorage = "friend";
+const std::string Member::LazyStorage = "lazy";
 const std::string * Member::Storage[] = {
         &StaticStorage, &InlineStorage, &VolatileStorage, &AutoStorage,
-        &FriendStorage, NULL
+        &FriendStorage, &LazyStorage, NULL
 };
 
 const std::string Member::MainFunctionId = "main";
+
+// Alignment
+const unsigned int Member::CacheLineSize = 64;
+const std::string Member::AlignedSpecifier = "alignas(64)";
+
+// Sections
+const std::string Class::HotSection  = "hot";
+const std::string Class::ColdSection = "cold";
 
 // Type
 const std::string Member::VoidType = "void";
@@ -169,8 +183,10 @@ std::string Member::getInterfaceModifiersAsString() const
     const Modifiers &mdfs = getModifiers();
     Modifiers::const_iterator it = mdfs.begin();
     for(; it != mdfs.end(); ++it) {
-        toret += ' ';
-        toret += **it;
+        if ( *it != &Member::MdfAligned ) {
+            toret += ' ';
+            toret += **it;
+        }
     }
 
     return toret;
@@ -183,7 +199,9 @@ std::string Member::getImplementationModifiersAsString() const
     const Modifiers &mdfs = getModifiers();
     Modifiers::const_iterator it = mdfs.begin();
     for(; it != mdfs.end(); ++it) {
-        if ( *it != &Member::MdfExplicit ) {
+        if ( *it != &Member::MdfExplicit
+          && *it != &Member::MdfAligned )
+        {
             toret += ' ';
             toret += **it;
         }
@@ -227,6 +245,45 @@ void ClassRelated::chk(const Member &m)
     }
 }
 
+// ----------------------------------------------------------------------- Data
+std::string Data::getLazyAccessor(const std::string &storage) const
+{
+    static const std::string InstanceName = "lazyInstance";
+    std::string type;
+    std::string toret;
+
+    // The type of the data
+    type += getInterfaceModifiersAsString();
+    type += ' ';
+    type += getType();
+
+    if ( isPointer() ) {
+        type += Member::MdfIsPointer;
+    }
+
+    // Prototype of the accessor, returning a reference
+    toret += storage;
+    toret += type;
+    toret += Member::MdfIsReference;
+    toret += ' ';
+    toret += getName();
+    toret += " ()\n";
+
+    // Body, holding the data
+    toret += Method::OpenBrace;
+    toret += ' ';
+    toret += Member::StaticStorage + type + ' ' + InstanceName;
+
+    if ( !getInitialValue().empty() ) {
+        toret += " = " + getInitialValue();
+    }
+
+    toret += Member::Semicolon;
+    toret += " return " + InstanceName + Member::Semicolon + " }";
+
+    return toret;
+}
+
 // ------------------------------------------------------------------ Attribute
 void Attribute::chkBasic() const
 {
@@ -235,10 +292,23 @@ void Attribute::chkBasic() const
 
     // Check legality of initial value
     if ( getSystemStorage() != &Member::StaticStorage
+      && !isLazy()
       && !( getInitialValue().empty() ) )
     {
         throw SemanticError( "attribute must be static in order to have an inital value" );
     }
+
+    if ( isLazy()
+      && isReference() )
+    {
+        throw SemanticError( "lazy attributes cannot be references" );
+    }
+
+    if ( isLazy()
+      && isAligned() )
+    {
+        throw SemanticError( "lazy attributes cannot be aligned" );
+    }
 }
 
 void Attribute::chkLow() const
@@ -254,6 +324,21 @@ void Attribute::chkHigh() const
 {
 }
 
+bool Attribute::isAtomic() const
+{
+    // The last component of the name, leaving out template arguments (std::atomic<std::size_t>)
+    const std::string type = getType().substr( 0, getType().find( '<' ) );
+    const std::string::size_type pos = type.rfind( AccessOperator );
+    std::string name = ( pos == std::string::npos ) ? type : type.substr( pos + AccessOperator.length() );
+
+    // std::atomic_int, std::atomic_flag... or typedefs as AtomicCounter
+    for(unsigned int i = 0; i < name.length(); ++i) {
+        name[ i ] = std::tolower( name[ i ] );
+    }
+
+    return ( name.compare( 0, 6, "atomic" ) == 0 );
+}
+
 std::string Attribute::getPrototype()
 {
     std::string toret;
@@ -263,6 +348,17 @@ std::string Attribute::getPrototype()
     // Add visibility
     toret += getVisibility() + ": ";
 
+    // Lazy attributes are static data behind an accessor
+    if ( isLazy() ) {
+        toret += getLazyAccessor( Member::StaticStorage );
+        goto End;
+    }
+
+    // Add alignment
+    if ( isAligned() ) {
+        toret += AlignedSpecifier + ' ';
+    }
+
     // Add storage
     if ( getSystemStorage() != NULL ) {
         toret += getStorage();
@@ -273,7 +369,7 @@ std::string Attribute::getPrototype()
 
     // Add type
     toret += ' ';
-    toret += getType();
+    toret += getStoredType();
     toret += ' ';
 
     // Add pointer or reference marks
@@ -287,14 +383,18 @@ std::string Attribute::getPrototype()
 
     // Add name
     toret += getName();
+    toret += getArrayMark();
     toret += Method::Semicolon;
 
+    End:
     return toret;
 }
 
 void Attribute::setInitialValue(const std::string &v)
 {
-    if ( getSystemStorage() != &Member::StaticStorage ) {
+    if ( getSystemStorage() != &Member::StaticStorage
+      && !isLazy() )
+    {
         throw SemanticError( "attribute must be static to have an inital value" );
     }
 
@@ -308,16 +408,22 @@ std::string Attribute::getImplementation()
     if ( isStatic() ) {
         const std::string &initValue = getInitialValue();
 
+        // Add alignment, which must be the same in the definition
+        if ( isAligned() ) {
+            toret += AlignedSpecifier;
+        }
+
         // Add modifiers
         toret += getImplementationModifiersAsString();
 
         // Add type
         toret += ' ';
-        toret += getType();
+        toret += getStoredType();
 
         // Add name
         toret += ' ';
         toret += getQualifiedName();
+        toret += getArrayMark();
 
         // Add init value
         if ( !initValue.empty() ) {
@@ -336,6 +442,14 @@ void Method::chkBasic() const
     // Chk it is inside a class
     ClassRelated::chk( *this );
 
+    if ( isLazy() ) {
+        throw SemanticError( "methods cannot be lazy" );
+    }
+
+    if ( isAligned() ) {
+        throw SemanticError( "methods cannot be aligned" );
+    }
+
     // Chk various
     if ( isPureVirtual()
       && !getBody().empty() )
@@ -497,6 +611,12 @@ std::string Method::getPrototype()
         toret += Member::MdfConst;
     }
 
+    // Add final mark
+    if ( isFinal() ) {
+        toret += ' ';
+        toret += Module::RWordFinal;
+    }
+
     // Add virtual mark if needed
     if ( isPureVirtual() ) {
         toret += " = 0";
@@ -555,6 +675,12 @@ std::string Method::getInline()
         toret += Member::MdfConst;
     }
 
+    // Add final mark
+    if ( isFinal() ) {
+        toret += ' ';
+        toret += Module::RWordFinal;
+    }
+
     // Add quicklist
     if ( !getQuickInitList().empty() )
     {
@@ -572,20 +698,22 @@ std::string Method::getInline()
     return toret;
 }
 
-std::string Method::getImplementation()
+std::string Method::getReturnType() const
 {
     std::string toret;
-    std::string parameters;
-
-    toret.clear();
+    const Modifiers mdfs = getModifiers();
 
-    if ( isPureVirtual() ) {
-        goto End;
+    // Add modifiers (virtual is only allowed inside the class declaration)
+    for(Modifiers::const_iterator it = mdfs.begin(); it != mdfs.end(); ++it) {
+        if ( *it != &Member::MdfExplicit
+          && *it != &Member::MdfVirtual
+          && *it != &Member::MdfAligned )
+        {
+            toret += ' ';
+            toret += **it;
+        }
     }
 
-    // Add modifiers
-    toret += getImplementationModifiersAsString();
-
     // Add type
     if ( !isConstructor()
       && !isDestructor() )
@@ -603,6 +731,23 @@ std::string Method::getImplementation()
         toret += Member::MdfIsReference;
     }
 
+    return toret;
+}
+
+std::string Method::getImplementation()
+{
+    std::string toret;
+    std::string parameters;
+
+    toret.clear();
+
+    if ( isPureVirtual() ) {
+        goto End;
+    }
+
+    // Add modifiers, type and marks
+    toret += getReturnType();
+
     // Add name
     toret += ' ';
     toret += getQualifiedName();
@@ -678,6 +823,16 @@ void Constant::chkBasic() const
     if ( getInitialValue().empty() ) {
         throw SemanticError( ( getName() + " constant should have an initial value" ).c_str() );
     }
+
+    if ( isLazy()
+      && isReference() )
+    {
+        throw SemanticError( "lazy constants cannot be references" );
+    }
+
+    if ( isAligned() ) {
+        throw SemanticError( "constants cannot be aligned" );
+    }
 }
 
 void Constant::chkLow() const
@@ -696,11 +851,30 @@ std::string Constant::getPrototype()
 {
     std::string toret;
 
-    toret = Module::RWordExtern;
+    // Lazy constants are behind an accessor, defined in the header
+    if ( isLazy() ) {
+        toret = getLazyAccessor( Member::InlineStorage );
+        goto End;
+    }
 
-    // Add storage
-    if ( getSystemStorage() != NULL ) {
-        toret += getStorage();
+    if ( compileTime ) {
+        // Add storage
+        if ( getSystemStorage() != NULL ) {
+            toret += getStorage() + ' ';
+        }
+
+        if ( inlineVariable ) {
+            toret += Member::InlineStorage + ' ';
+        }
+
+        toret += Module::RWordConstexpr;
+    } else {
+        toret = Module::RWordExtern;
+
+        // Add storage
+        if ( getSystemStorage() != NULL ) {
+            toret += getStorage();
+        }
     }
 
     // Add modifiers
@@ -708,7 +882,7 @@ std::string Constant::getPrototype()
 
     // Add type
     toret += ' ';
-    toret += getType();
+    toret += getStoredType();
     toret += ' ';
 
     // Add pointer or reference marks
@@ -721,8 +895,18 @@ std::string Constant::getPrototype()
     }
 
     // Add name
-    toret += getName() + Method::Semicolon;
+    toret += getName();
+    toret += getArrayMark();
 
+    // Add initial value, known at compile time
+    if ( compileTime ) {
+        toret += '=';
+        toret += getInitialValue();
+    }
+
+    toret += Method::Semicolon;
+
+    End:
     return toret;
 }
 
@@ -730,6 +914,13 @@ std::string Constant::getImplementation()
 {
     std::string toret;
 
+    // Compile-time and lazy constants are completely defined in the header
+    if ( compileTime
+      || isLazy() )
+    {
+        goto End;
+    }
+
     // Add storage
     if ( getSystemStorage() != NULL ) {
         toret += getStorage();
@@ -740,7 +931,7 @@ std::string Constant::getImplementation()
 
     // Add type
     toret += ' ';
-    toret += getType();
+    toret += getStoredType();
     toret += ' ';
 
     // Add pointer or reference marks
@@ -754,16 +945,17 @@ std::string Constant::getImplementation()
 
     // Add name
     toret += getQualifiedName();
+    toret += getArrayMark();
 
     // Add initial value
-    const std::string &init = getInitialValue();
-    if ( !init.empty() ) {
+    if ( !getInitialValue().empty() ) {
         toret += '=';
-        toret += init;
+        toret += getInitialValue();
     }
 
     toret += Method::Semicolon;
 
+    End:
     return toret;
 }
 
@@ -774,6 +966,10 @@ void Function::chkBasic() const
 
     NamespaceRelated::chk( *this );
 
+    if ( isAligned() ) {
+        throw SemanticError( "functions cannot be aligned" );
+    }
+
     if ( storage != NULL
       && !isStatic()
       && !isInline() )
@@ -1043,7 +1239,17 @@ std::string Class::getDeclaration()
         toret.push_back( ':' );
     }
 
-    toret += Module::RWordClass + ' ' + getName();
+    toret += Module::RWordClass + ' ';
+
+    if ( isAligned() ) {
+        toret += Member::AlignedSpecifier + ' ';
+    }
+
+    toret += getName();
+
+    if ( isFinal() ) {
+        toret += ' ' + Module::RWordFinal;
+    }
 
     if ( parentList.size() > 0 ) {
         toret.append( Class::Colon );
@@ -1073,6 +1279,34 @@ void Class::setClassVisibility(const std::string * v)
 
 Attribute &Class::addAttribute(Attribute &atr)
 {
+    const Attribute * previous = NULL;
+
+    // Find the previous field
+    for(unsigned int i = attributes.size(); previous == NULL && i > 0; --i) {
+        const Attribute * other = (const Attribute *) attributes[ i - 1 ];
+
+        if ( !other->isStatic()
+          && !other->isLazy() )
+        {
+            previous = other;
+        }
+    }
+
+    atr.setSection( currentSection );
+
+    // A new section starts a new cache line
+    if ( currentSection != NULL
+      && !atr.isStatic()
+      && !atr.isLazy()
+      && !atr.isAligned()
+      && ( previous == NULL || previous->getSection() != currentSection ) )
+    {
+        Member::Modifiers mdfs = atr.getModifiers();
+
+        mdfs.push_back( &Member::MdfAligned );
+        atr.setModifiers( mdfs );
+    }
+
     atr.myContainer = this;
     attributes.push_back( &atr );
     return atr;
@@ -1342,6 +1576,35 @@ void Module::addDependency(const std::string &fileName)
     }
 }
 
+void Module::addFileDependency(const std::string &fileName)
+{
+    if ( std::find( fileDependencies.begin(), fileDependencies.end(), fileName )
+                                                    == fileDependencies.end() )
+    {
+        fileDependencies.push_back( fileName );
+    }
+}
+
+void Module::addClass(const std::string &name, const std::string &scope,
+                      const std::vector<std::string> &parents)
+{
+    ClassInfo &info = classes[ name ];
+
+    info.scope = scope;
+    info.parents = parents;
+}
+
+void Module::addMethod(const std::string &className, const std::string &name, bool canBeFinal)
+{
+    ClassInfo &info = classes[ className ];
+
+    info.methods.insert( name );
+
+    if ( canBeFinal ) {
+        info.virtualMethods.insert( name );
+    }
+}
+
 }
 
 }
@@ -4,6 +4,8 @@
 #include "stringman.h"
 
 #include <vector>
+#include <map>
+#include <set>
 #include <stdexcept>
 #include <algorithm>
 #include <memory>
@@ -230,6 +232,7 @@ public:
     static const std::string VolatileStorage;
     static const std::string AutoStorage;
     static const std::string FriendStorage;
+    static const std::string LazyStorage;
 
     /// List of all available storages
     static const std::string * Storage[];
@@ -250,6 +253,7 @@ public:
     static const std::string MdfVirtual;
     static const std::string MdfUnsigned;
     static const std::string MdfExplicit;
+    static const std::string MdfAligned;
     static const std::string MdfIsPointer;
     static const std::string MdfIsReference;
 
@@ -266,6 +270,12 @@ public:
     /// The entry point's name
     static const std::string MainFunctionId;
 
+    /// The size of a cache line, in most processors
+    static const unsigned int CacheLineSize;
+
+    /// The specifier for aligning to a cache line (C++11)
+    static const std::string AlignedSpecifier;
+
     /// Type for storing the modifiers applyable to this member
     /// It is a std::vector of std::string *
     typedef std::vector<const std::string *> Modifiers;
@@ -384,6 +394,18 @@ public:
     bool isStatic() const
         { return ( getSystemStorage() == &Member::StaticStorage ); }
 
+    /// Determines whether the member is lazy (initialized when first used) or not
+    /// @return true if the member has lazy storage, false otherwise
+    /// @see Storage, getStorage
+    bool isLazy() const
+        { return ( getSystemStorage() == &Member::LazyStorage ); }
+
+    /// Determines whether the member is aligned to a cache line
+    /// @return true if the member has the aligned modifier, false otherwise
+    /// @see Modifier
+    bool isAligned() const
+        { return ( lookForModifier( Member::MdfAligned ) != NULL ); }
+
     /// Determines whether the return type of the member is a pointer
     /// @return true if the type of the member is a pointer, false otherwise
     bool isPointer() const
@@ -491,6 +513,10 @@ friend class Namespace;
 public:
     static const std::string Colon;
 
+    /// The sections for grouping attributes in their own cache lines
+    static const std::string HotSection;
+    static const std::string ColdSection;
+
     /// Holds the information for a given parent class
     class Parent {
     public:
@@ -544,9 +570,24 @@ private:
     /// Visibility of this class
     /// @see Member::Visibility
     const std::string * visibility;
+
+    /// Whether the class cannot be derived from
+    bool finalClass;
+
+    /// Whether all classes derived from this one are in its module
+    bool closedClass;
+
+    /// Whether the class is aligned to a cache line
+    bool alignedClass;
+
+    /// The section of the attributes being added
+    /// @see HotSection, ColdSection
+    const std::string * currentSection;
 public:
     Class(Container * c, Module *m, const std::string &n = "")
-        : Container( c, m, n ), visibility( &Member::PublicVisibility )
+        : Container( c, m, n ), visibility( &Member::PublicVisibility ),
+          finalClass( false ), closedClass( false ), alignedClass( false ),
+          currentSection( NULL )
         { setCurrentVisibility( &Member::PrivateVisibility ); }
     ~Class();
 
@@ -566,11 +607,56 @@ public:
         { return visibility; }
     void setClassVisibility(const std::string * v);
 
+    /// Makes the class final, so it cannot be derived from (C++11)
+    void setFinal()
+        { finalClass = true; }
+
+    /// Determines whether the class is final
+    bool isFinal() const
+        { return finalClass; }
+
+    /// Makes the root of a closed hierarchy, so all of its subclasses
+    /// are in the same module
+    void setClosed()
+        { closedClass = true; }
+
+    /// Determines whether the class is the root of a closed hierarchy
+    bool isClosed() const
+        { return closedClass; }
+
+    /// Makes the class aligned to a cache line, so objects do not share lines
+    void setAligned()
+        { alignedClass = true; }
+
+    /// Determines whether the class is aligned to a cache line
+    bool isAligned() const
+        { return alignedClass; }
+
+    /// Changes the section of the attributes added from now on
+    /// @param s The section (HotSection or ColdSection)
+    void setCurrentSection(const std::string * s)
+        { currentSection = s; }
+
+    /// Returns the section of the attributes being added, NULL if none
+    const std::string * getCurrentSection() const
+        { return currentSection; }
+
+    /// Returns the attributes of this class, in order of appearance
+    /// @see Container::MembersList, attributes, Attribute
+    const MembersList &getAttributes() const
+        { return attributes; }
+
+    /// Returns the methods of this class
+    /// @see Container::MembersList, methods, Method
+    const MembersList &getMethods() const
+        { return methods; }
+
     /// Returns the declaration of the header of the class (class name and inheritance)
     /// @return the declaration of the class as a std::string
     std::string getDeclaration();
 
-    /// Adds an attribute to the list of attributes for this class
+    /// Adds an attribute to the list of attributes for this class.
+    /// When it is the first one of a section, it is aligned to a cache line.
     /// @param atr An object of the Attribute class
     /// @see Container::MembersList, attributes, Attribute
     Attribute &addAttribute(Attribute & atr);
@@ -595,10 +681,10 @@ public:
 class Data : public Member {
 public:
     Data(unsigned int l, const std::string &n, const std::string * t = &VoidType)
-        : Member( l, n, t )
+        : Member( l, n, t ), charArray( false )
         {}
     Data(unsigned int l,const std::string &n, const std::string &t)
-        : Member( l, n, t )
+        : Member( l, n, t ), charArray( false )
         {}
 
     /// Sets the initialization value for this data member
@@ -611,8 +697,32 @@ public:
     /// @return The literal for initialization
     virtual const std::string &getInitialValue() const
         { return initValue; }
+
+    /// Makes the data member to be stored as an array of char,
+    /// i.e., a std::string initialized with a string literal,
+    /// so it needs no constructor to run at startup
+    void setCharArray()
+        { charArray = true; }
+
+    /// Determines whether the data member is stored as an array of char
+    bool isCharArray() const
+        { return charArray; }
+
+    /// Returns the type of the data member, as written in the generated code
+    const std::string &getStoredType() const
+        { return charArray ? CharType : getType(); }
+
+    /// Returns the mark following the name of the data member ("[]" for arrays)
+    std::string getArrayMark() const
+        { return charArray ? "[]" : ""; }
+
+    /// Returns the accessor of lazy data: a function holding the data in a local
+    /// static variable, initialized (thread-safely, since C++11) when first called
+    /// @param storage The storage of the accessor (i.e., "static" for attributes)
+    std::string getLazyAccessor(const std::string &storage) const;
 private:
     std::string initValue;
+    bool charArray;
 };
 
 /// Parent class with members related to classes
@@ -634,7 +744,7 @@ public:
     /// @param t The primitive type (defaults to void)
     /// @see Member::Types
     Attribute(unsigned int l, const std::string &n, const std::string * t = &VoidType)
-        : Data( l, n, t )
+        : Data( l, n, t ), section( NULL )
         {}
 
     /// Constructor for attributes of user-defined data type
@@ -642,7 +752,7 @@ public:
     /// @param n The name of the attribute
     /// @param t The user-defined type, as std::string
     Attribute(unsigned int l, const std::string &n, const std::string &t)
-        : Data( l, n, t )
+        : Data( l, n, t ), section( NULL )
         {}
 
     void chkBasic()  const;
@@ -664,6 +774,18 @@ public:
     std::string getInline()
         { return std::string(); }
 
+    /// Returns the section the attribute is in, NULL if none
+    /// @see Class::HotSection, Class::ColdSection
+    const std::string * getSection() const
+        { return section; }
+
+    /// Changes the section the attribute is in
+    void setSection(const std::string * s)
+        { section = s; }
+
+    /// Determines whether the attribute is atomic (std::atomic)
+    bool isAtomic() const;
+
     const Class * getContainer() const
         { return (Class *) Member::getContainer(); }
     Class * getContainer()
@@ -671,6 +793,8 @@ public:
 
     std::string getQualifiedName()
         { return buildQualifiedName( this->getContainer() ); }
+private:
+    const std::string * section;
 };
 
 /// Class representing methods and functions
@@ -735,7 +859,8 @@ public:
     /// @param t The primitive return type (defaults to void)
     /// @see Member::Types
     Method(unsigned int l, const std::string &n, const std::string * t = &VoidType)
-        : Code( l, n, t ), constFunction( false ), pureVirtualFunction( false )
+        : Code( l, n, t ), constFunction( false ), pureVirtualFunction( false ),
+          finalFunction( false )
     {}
 
     /// Constructor for methods returning an user-defined data type
@@ -743,13 +868,18 @@ public:
     /// @param n The name of the method
     /// @param t The user-defined return type (as an std::string)
     Method(unsigned int l, const std::string &n, const std::string &t)
-        : Code( l, n, t ), constFunction( false ), pureVirtualFunction( false )
+        : Code( l, n, t ), constFunction( false ), pureVirtualFunction( false ),
+          finalFunction( false )
     {}
 
     std::string getPrototype();
     std::string getImplementation();
     std::string getInline();
 
+    /// Returns the type returned, with its modifiers and marks,
+    /// as written out of the class (i.e., "const std::string &")
+    std::string getReturnType() const;
+
     /// Changes whether the method is const (must have a const on its right)
     /// @param v Whether it is or not (defaults to true)
     void setConstMethod(bool v = true)
@@ -760,6 +890,14 @@ public:
     bool isConstMethod()
         { return constFunction; }
 
+    /// Makes the virtual method final, so it cannot be overridden (C++11)
+    void setFinal()
+        { finalFunction = true; }
+
+    /// Determines whether the method is final
+    bool isFinal() const
+        { return finalFunction; }
+
     /// Returns the quicklist initialisation for the constructor (no individual parsing is done)
     /// @return The quickinitlist as std::string
     const std::string getQuickInitList() const
@@ -812,6 +950,7 @@ private:
     bool constFunction;
     std::string quickInit;
     bool pureVirtualFunction;
+    bool finalFunction;
 };
 
 class Function;
@@ -956,6 +1095,45 @@ public:
     typedef std::vector<std::string> Dependencies;
     /// A type for pointing to a member of the dependencies list
     typedef Dependencies::iterator PtrDependencies;
+    /// The kinds of text in the interface of an exported symbol
+    enum InterfaceKind { DeclarationText, DataText, SignatureText, InlineText };
+
+    /// A piece of the interface of an exported symbol, as written in the header
+    struct InterfaceText {
+        InterfaceKind kind;
+        std::string text;
+
+        InterfaceText(InterfaceKind k, const std::string &t)
+            : kind( k ), text( t )
+            {}
+    };
+
+    /// A type for storing the interface of an exported symbol
+    typedef std::vector<InterfaceText> Interface;
+
+    /// A type for storing the interface of each exported symbol, by qualified name
+    typedef std::map<std::string, Interface> Exports;
+    /// A type for storing a set of qualified names
+    typedef std::set<std::string> Names;
+
+    /// What a class declares, as needed to build the hierarchy of classes
+    struct ClassInfo {
+        /// The qualified name of the namespace or class the class is inside of
+        std::string scope;
+
+        /// The names of the parent classes, as written
+        std::vector<std::string> parents;
+
+        /// The names of all methods
+        Names methods;
+
+        /// The names of methods declared virtual, which could be final
+        /// (neither pure nor destructors)
+        Names virtualMethods;
+    };
+
+    /// A type for storing the classes declared, by qualified name
+    typedef std::map<std::string, ClassInfo> Classes;
 
     /// The mark (prefix) identifying directives (#include, #ifdef...)
     static const std::string DirectiveMark;
@@ -967,8 +1145,11 @@ public:
     static const std::string RWordInclude;
     static const std::string RWordImport;
     static const std::string RWordExtern;
+    static const std::string RWordConstexpr;
+    static const std::string RWordFinal;
     static const std::string RWordUsing;
     static const std::string RWordClass;
+    static const std::string RWordClosed;
     static const std::string RWordNamespace;
     static const std::string RWordTypedef;
 
@@ -983,6 +1164,11 @@ public:
 private:
     State state;
     Dependencies dependencies;
+    Dependencies fileDependencies;
+    Dependencies imports;
+    Exports exports;
+    Names exportedClasses;
+    Classes classes;
     std::auto_ptr<EntryPoint> entryPoint;
     Namespace * mainNamespace;
     Namespace * currentNamespace;
@@ -1053,6 +1239,66 @@ public:
     const Dependencies &getDependencies() const
         { return dependencies; }
 
+    /// Adds a file dependency, namely the imported headers and the
+    /// (#include "...") included files, standard or not.
+    /// @param f The file name, as it appears in the generated header
+    void addFileDependency(const std::string &f);
+
+    /// Returns the list of files the generated header includes
+    /// @return A Dependencies object
+    const Dependencies &getFileDependencies() const
+        { return fileDependencies; }
+
+    /// Adds an imported module (import X;)
+    /// @param f The header of the module, as it appears in the dependencies
+    void addImport(const std::string &f)
+        { imports.push_back( f ); }
+
+    /// Returns the headers of the imported modules, a subset of the dependencies
+    /// @return A Dependencies object
+    const Dependencies &getImports() const
+        { return imports; }
+
+    /// Adds to the interface of an exported symbol (a class, function or constant)
+    /// @param symbol The qualified name of the symbol (i.e., Utils::Math::sqr)
+    /// @param kind What the text is: a declaration (class, typedef), data, a prototype or code
+    /// @param text The text written in the header for it
+    void addExport(const std::string &symbol, InterfaceKind kind, const std::string &text)
+        { exports[ symbol ].push_back( InterfaceText( kind, text ) ); }
+
+    /// Returns the interface of each exported symbol
+    /// @return An Exports object
+    const Exports &getExports() const
+        { return exports; }
+
+    /// Adds an exported class, directly inside a namespace
+    /// @param name The qualified name of the class
+    void addExportedClass(const std::string &name)
+        { exportedClasses.insert( name ); }
+
+    /// Returns the exported classes which are directly inside a namespace
+    /// @return A Names object
+    const Names &getExportedClasses() const
+        { return exportedClasses; }
+
+    /// Adds a class declared in the module, inside a namespace or another class
+    /// @param name The qualified name of the class
+    /// @param scope The qualified name of the namespace or class it is inside of
+    /// @param parents The names of its parent classes, as written
+    void addClass(const std::string &name, const std::string &scope,
+                  const std::vector<std::string> &parents);
+
+    /// Adds a method to a class declared in the module
+    /// @param className The qualified name of the class
+    /// @param name The name of the method
+    /// @param canBeFinal Whether it is virtual, but neither pure nor a destructor
+    void addMethod(const std::string &className, const std::string &name, bool canBeFinal);
+
+    /// Returns the classes declared in the module
+    /// @return A Classes object
+    const Classes &getClasses() const
+        { return classes; }
+
     void chkBasic()  const;
     void chkHigh()   const;
     void chkMedium() const;
@@ -1116,19 +1362,35 @@ public:
     /// @param n The name of the Constant
     /// @param t The return type of the Constant, provided it is a primitive data type
     Constant(unsigned int l, const std::string &n, const std::string * t = &VoidType)
-        : Data( l, n, t )
+        : Data( l, n, t ), compileTime( false ), inlineVariable( false )
         {}
     /// Constant constructor
     /// @param l The line number in which this Constant appears
     /// @param n The name of the Constant
     /// @param t The return type of the function, provided it is a user-defined data type
     Constant(unsigned int l, const std::string &n, const std::string &t)
-        : Data( l, n, t )
+        : Data( l, n, t ), compileTime( false ), inlineVariable( false )
         {}
 
     std::string getPrototype();
     std::string getImplementation();
 
+    /// Determines whether the type of the constant is a literal type:
+    /// a native type, neither a pointer nor a reference
+    bool hasLiteralType() const
+        { return ( !isUserType() && getSystemType() != &VoidType && !isPointer() && !isReference() ); }
+
+    /// Makes the constant to be defined as constexpr in the header,
+    /// instead of declared extern in the header and defined in the implementation
+    /// @param inlineVar Whether to define it as an inline variable (C++17),
+    ///                  so all modules share the same object
+    void setCompileTime(bool inlineVar = false)
+        { compileTime = true; inlineVariable = inlineVar; }
+
+    /// Determines whether the constant is defined as constexpr in the header
+    bool isCompileTime() const
+        { return compileTime; }
+
     std::string getInline()
         { return std::string(); }
 
@@ -1144,6 +1406,9 @@ public:
     void chkLow()    const;
     void chkMedium() const;
     void chkHigh()   const;
+private:
+    bool compileTime;
+    bool inlineVariable;
 };
 
 /**
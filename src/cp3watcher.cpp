@@ -0,0 +1,291 @@
+// cp3watcher.cpp
+/*
+    Implementation of the watch mode
+*/
+
+#include "cp3watcher.h"
+#include "appinfo.h"
+#include "fileman.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <unistd.h>
+#include <poll.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+namespace Cp3mm {
+
+const int Watcher::DebounceTime = 100;
+
+static std::string joinPath(const std::string &dir, const std::string &name)
+{
+    std::string toret = name;
+
+    if ( !dir.empty()
+      && dir != "." )
+    {
+        toret = dir;
+
+        if ( dir[ dir.length() - 1 ] != '/' ) {
+            toret += '/';
+        }
+
+        toret += name;
+    }
+
+    return toret;
+}
+
+Watcher::~Watcher()
+{
+    if ( fdNotify >= 0 ) {
+        close( fdNotify );
+    }
+}
+
+void Watcher::addDirectory(const std::string &dir)
+{
+    dirs.push_back( dir );
+}
+
+void Watcher::scan(const std::string &dir)
+{
+    DIR * d = opendir( dir.c_str() );
+    struct dirent * entry;
+    struct stat info;
+    int wd;
+
+    if ( d == NULL ) {
+        throw std::runtime_error( "unable to read directory '" + dir + '\'' );
+    }
+
+    wd = inotify_add_watch( fdNotify, dir.c_str(),
+                            IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE );
+    if ( wd < 0 ) {
+        closedir( d );
+        throw std::runtime_error( "unable to watch directory '" + dir + '\'' );
+    }
+
+    watchedDirs[ wd ] = dir;
+
+    while( ( entry = readdir( d ) ) != NULL ) {
+        const std::string name = entry->d_name;
+        const std::string path = joinPath( dir, name );
+
+        if ( name == "."
+          || name == ".." )
+        {
+            continue;
+        }
+
+        if ( stat( path.c_str(), &info ) == 0 ) {
+            if ( S_ISDIR( info.st_mode ) ) {
+                scan( path );
+            }
+            else
+            if ( AppInfo::isAcceptedExt( FileMan::getExt( name ) ) ) {
+                modules.insert( path );
+            }
+        }
+    }
+
+    closedir( d );
+}
+
+int Watcher::watch()
+{
+    FileSet changed;
+
+    fdNotify = inotify_init();
+    if ( fdNotify < 0 ) {
+        throw std::runtime_error( "unable to use inotify" );
+    }
+
+    // Generate everything first
+    for(unsigned int i = 0; i < dirs.size(); ++i) {
+        scan( dirs[ i ] );
+    }
+
+    for(FileSet::const_iterator it = modules.begin(); it != modules.end(); ++it) {
+        driver.processFile( *it, options );
+        updateDependencies( *it );
+    }
+
+    std::fprintf( driver.getOutput(), "Watching %u module(s)...\n", (unsigned int) modules.size() );
+    std::fflush( driver.getOutput() );
+
+    // Now regenerate as they change
+    for(;;) {
+        changed.clear();
+        waitForChanges( changed );
+        driver.forgetImports();
+        regenerate( changed );
+        std::fflush( driver.getOutput() );
+    }
+
+    return EXIT_FAILURE;
+}
+
+void Watcher::waitForChanges(FileSet &changed)
+{
+    char buffer[ 8192 ] __attribute__(( aligned( __alignof__( struct inotify_event ) ) ));
+    struct pollfd pfd;
+    const struct inotify_event * event;
+    ssize_t numRead;
+    int timeout = -1;
+
+    pfd.fd = fdNotify;
+    pfd.events = POLLIN;
+
+    // Wait for a change, then until no more changes arrive for a while
+    while( changed.empty()
+        || poll( &pfd, 1, timeout ) > 0 )
+    {
+        numRead = read( fdNotify, buffer, sizeof( buffer ) );
+
+        if ( numRead < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+
+            throw std::runtime_error( "unable to read inotify events" );
+        }
+
+        for(char * cursor = buffer; cursor < buffer + numRead; cursor += sizeof( struct inotify_event ) + event->len)
+        {
+            event = (const struct inotify_event *) cursor;
+
+            if ( event->len == 0 ) {
+                continue;
+            }
+
+            const std::string path = joinPath( watchedDirs[ event->wd ], event->name );
+
+            if ( event->mask & IN_ISDIR ) {
+                if ( event->mask & IN_CREATE ) {
+                    scan( path );
+                }
+            }
+            else
+            if ( !( event->mask & IN_CREATE )
+              && AppInfo::isAcceptedExt( FileMan::getExt( path ) ) )
+            {
+                changed.insert( path );
+            }
+        }
+
+        timeout = DebounceTime;
+    }
+}
+
+void Watcher::regenerate(const FileSet &changed)
+{
+    std::string contents;
+    uint64_t oldHash;
+    uint64_t newHash;
+
+    for(FileSet::const_iterator it = changed.begin(); it != changed.end(); ++it) {
+        const std::string header = Driver::getOutputName( options, *it, AppInfo::CHeaderFilesExt );
+
+        modules.insert( *it );
+
+        oldHash = 0;
+        if ( Driver::readFile( header, contents ) ) {
+            oldHash = Driver::hash( contents );
+        }
+
+        if ( !driver.processFile( *it, options ) ) {
+            continue;
+        }
+
+        updateDependencies( *it );
+
+        newHash = 0;
+        if ( Driver::readFile( header, contents ) ) {
+            newHash = Driver::hash( contents );
+        }
+
+        // Report the modules affected by the change in the header
+        if ( oldHash != newHash ) {
+            FileSet importers;
+
+            collectImporters( Driver::getAbsoluteFileName( header ), importers );
+
+            if ( !importers.empty() ) {
+                std::fprintf( driver.getOutput(), "Header '%s' changed, affecting:", header.c_str() );
+
+                for(FileSet::const_iterator itImp = importers.begin(); itImp != importers.end(); ++itImp)
+                {
+                    std::fprintf( driver.getOutput(), " '%s'", itImp->c_str() );
+                }
+
+                std::fprintf( driver.getOutput(), "\n" );
+            }
+        }
+    }
+}
+
+void Watcher::updateDependencies(const std::string &module)
+{
+    const std::string depsName = Driver::getOutputName( options, module, AppInfo::DepFilesExt );
+    const std::string dir = Driver::getDirectory( depsName );
+    FileSet &deps = dependencies[ module ];
+    std::string contents;
+    std::string::size_type pos = 0;
+    std::string::size_type posEnd;
+
+    deps.clear();
+
+    if ( Driver::readFile( depsName, contents ) ) {
+        while( pos < contents.length() ) {
+            posEnd = contents.find( '\n', pos );
+
+            if ( posEnd == std::string::npos ) {
+                posEnd = contents.length();
+            }
+
+            // Comments (i.e., the fingerprint of the interface) are skipped
+            if ( posEnd > pos
+              && contents[ pos ] != '#' )
+            {
+                std::string dep = contents.substr( pos, posEnd - pos );
+
+                if ( dep[ 0 ] != '/' ) {
+                    dep = dir + dep;
+                }
+
+                deps.insert( Driver::getAbsoluteFileName( dep ) );
+            }
+
+            pos = posEnd + 1;
+        }
+    }
+}
+
+void Watcher::collectImporters(const std::string &header, FileSet &importers) const
+{
+    std::vector<std::string> pending;
+
+    pending.push_back( header );
+
+    while( !pending.empty() ) {
+        const std::string current = pending.back();
+        pending.pop_back();
+
+        for(DependencyGraph::const_iterator it = dependencies.begin(); it != dependencies.end(); ++it)
+        {
+            if ( it->second.find( current ) != it->second.end()
+              && importers.insert( it->first ).second )
+            {
+                pending.push_back( Driver::getAbsoluteFileName(
+                        Driver::getOutputName( options, it->first, AppInfo::CHeaderFilesExt ) ) );
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,65 @@
+#ifndef CP3WATCHER_H_INCLUDED
+#define CP3WATCHER_H_INCLUDED
+
+#include "cp3driver.h"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+namespace Cp3mm {
+
+/**
+    The watch mode of cp3.
+    All modules (.mpp and .cp3 files) inside the watched directories are generated,
+    and then regenerated each time they are modified (this is detected by inotify).
+    Bursts of modifications (editors usually write files in several steps)
+    are gathered together before regenerating. When the header of a module changes,
+    the modules importing it (directly or indirectly) are reported.
+    @see Driver
+*/
+class Watcher {
+public:
+    /// Time to wait for more changes once one arrives, in milliseconds
+    static const int DebounceTime;
+
+    /// Creates a new watcher
+    /// @param d The driver to generate modules with
+    /// @param opts The options to generate modules with
+    Watcher(Driver &d, const Options &opts)
+        : driver( d ), options( opts ), fdNotify( -1 )
+        {}
+
+    ~Watcher();
+
+    /// Adds a directory to watch, along with its subdirectories
+    /// @param dir The path of the directory
+    void addDirectory(const std::string &dir);
+
+    /// Generates all modules, and then watches them forever
+    /// @return EXIT_FAILURE if watching is not possible
+    int watch();
+
+private:
+    typedef std::set<std::string> FileSet;
+    typedef std::map<std::string, FileSet> DependencyGraph;
+
+    void scan(const std::string &dir);
+    void waitForChanges(FileSet &changed);
+    void regenerate(const FileSet &changed);
+    void updateDependencies(const std::string &module);
+    void collectImporters(const std::string &header, FileSet &importers) const;
+
+    Driver &driver;
+    Options options;
+    int fdNotify;
+    std::vector<std::string> dirs;
+    std::map<int, std::string> watchedDirs;
+    FileSet modules;
+    DependencyGraph dependencies;
+};
+
+}
+
+#endif // CP3WATCHER_H_INCLUDED
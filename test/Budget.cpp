@@ -0,0 +1,19 @@
+#include "Budget.h"
+#line 10 "Budget.mpp"
+ Budget::Header::Header () :length( 0 ), flags( 0 ), kind( 0 )
+{}
+#line 12 "Budget.mpp"
+ long Budget::Header::getLength () const
+{ return length; }
+
+#line 2 "Budget.layout"
+static_assert( sizeof( ::Budget::Header ) <= 16, "Budget::Header: over its size budget of 16 bytes" );
+static_assert( alignof( ::Budget::Header ) <= 8, "Budget::Header: over its alignment budget of 8" );
+
+#line 22 "Budget.mpp"
+ int main ()
+{
+Budget::Header header;
+
+return ( header.getLength() == 0 ) ? 0 : 1;}
+
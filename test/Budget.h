@@ -0,0 +1,13 @@
+#ifndef __MODULE__BUDGET_
+#define __MODULE__BUDGET_
+namespace Budget {
+class Header{
+public:  Header ();
+public:  long getLength () const;
+private:  long length;
+private:  int flags;
+private:  char kind;
+}; // class Header
+} // namespace Budget
+#endif // module Budget
+
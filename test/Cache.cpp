@@ -0,0 +1,37 @@
+#include "Cache.h"
+#line 13 "Cache.mpp"
+ Cache::Counter::Counter () :value( 0 )
+{}
+#line 15 "Cache.mpp"
+ void Cache::Counter::increment ()
+{ ++value; }
+#line 17 "Cache.mpp"
+ long Cache::Counter::get () const
+{ return value; }
+#line 25 "Cache.mpp"
+ Cache::Stats::Stats () :hits( 0 ), misses( 0 ), requests( 0 ), created( 0 ), flags( 0 )
+{}
+#line 27 "Cache.mpp"
+ void Cache::Stats::hit ()
+{ ++hits; ++requests; }
+#line 29 "Cache.mpp"
+ long Cache::Stats::getHits () const
+{ return hits; }
+#line 31 "Cache.mpp"
+ std::size_t Cache::Stats::getRequests () const
+{ return requests; }
+#line 45 "Cache.mpp"
+ int main ()
+{
+Cache::Counter counters[ 2 ];
+Cache::Stats stats;
+
+counters[ 1 ].increment();
+stats.hit();
+
+return ( sizeof( Cache::Counter ) == 64
+&& alignof( Cache::Stats ) == 64
+&& counters[ 1 ].get() == 1
+&& stats.getHits() == 1
+&& stats.getRequests() == 1 ) ? 0 : 1;}
+
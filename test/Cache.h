@@ -0,0 +1,25 @@
+#ifndef __MODULE__CACHE_
+#define __MODULE__CACHE_
+#include <atomic>
+#include <cstddef>
+namespace Cache {
+class alignas(64) Counter{
+public:  Counter ();
+public:  void increment ();
+public:  long get () const;
+private:  long value;
+}; // class Counter
+class Stats{
+public:  Stats ();
+public:  void hit ();
+public:  long getHits () const;
+public:  std::size_t getRequests () const;
+private: alignas(64)  long hits;
+private:  long misses;
+private:  std::atomic<std::size_t> requests;
+private: alignas(64)  long created;
+private: alignas(64)  int flags;
+}; // class Stats
+} // namespace Cache
+#endif // module Cache
+
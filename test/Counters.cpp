@@ -0,0 +1,19 @@
+#include "Counters.h"
+#line 13 "Counters.mpp"
+ Counters::Counters::Counters () :hits( 0 ), misses( 0 ), errors( 0 ), created( 0 )
+{}
+#line 15 "Counters.mpp"
+ void Counters::Counters::hit ()
+{ ++hits; }
+#line 17 "Counters.mpp"
+ std::size_t Counters::Counters::getHits () const
+{ return hits; }
+#line 34 "Counters.mpp"
+ int main ()
+{
+Counters::Counters counters;
+
+counters.hit();
+
+return ( counters.getHits() == 1 ) ? 0 : 1;}
+
@@ -0,0 +1,23 @@
+#ifndef __MODULE__COUNTERS_
+#define __MODULE__COUNTERS_
+#include <atomic>
+#include <cstddef>
+namespace Counters {
+class Counters{
+public:  Counters ();
+public:  void hit ();
+public:  std::size_t getHits () const;
+private:  std::atomic<std::size_t> hits;
+private:  std::atomic<std::size_t> misses;
+private:  long padding1;
+private:  long padding2;
+private:  long padding3;
+private:  long padding4;
+private:  long padding5;
+private:  long padding6;
+private:  std::atomic<int> errors;
+private: alignas(64)  std::atomic<long> created;
+}; // class Counters
+} // namespace Counters
+#endif // module Counters
+
@@ -0,0 +1,8 @@
+#ifndef __MODULE__DISTANCE_
+#define __MODULE__DISTANCE_
+#include "Units.h"
+namespace Distance {
+ double getMarathon ();
+} // namespace Distance
+#endif // module Distance
+
@@ -0,0 +1,17 @@
+#ifndef __MODULE__DISTANCE_
+#define __MODULE__DISTANCE_
+#include "Units.h"
+namespace Distance {
+ double getMarathon ();
+} // namespace Distance
+#endif // module Distance
+
+#line 10 "stdin"
+ double Distance::getMarathon ()
+{
+return Units::toMeters( 26.2 );}
+#line 16 "stdin"
+ int main ()
+{
+return ( Distance::getMarathon() > 42000 ) ? 0 : 1;}
+
@@ -0,0 +1,18 @@
+#include "Inlining.h"
+#line 16 "Inlining.mpp"
+ void Inlining::Counter::addAll (int a, int b, int c, int d, int e)
+{
+add( a );
+add( b );
+add( c );
+add( d );
+add( e );}
+#line 33 "Inlining.mpp"
+ int main ()
+{
+Inlining::Counter counter;
+
+counter.addAll( 1, 2, 3, 4, Inlining::twice( 5 ) );
+
+return ( counter.get() == 20 ) ? 0 : 1;}
+
@@ -0,0 +1,19 @@
+#ifndef __MODULE__INLINING_
+#define __MODULE__INLINING_
+namespace Inlining {
+class Counter{
+public:  Counter () :value( 0 )
+{}
+public:  int get () const
+{ return value; }
+public:  void add (int x)
+{ value += x; }
+public:  void addAll (int a, int b, int c, int d, int e);
+private:  int value;
+}; // class Counter
+inline int twice (int x)
+{
+return x * 2;}
+} // namespace Inlining
+#endif // module Inlining
+
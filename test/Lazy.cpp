@@ -0,0 +1,13 @@
+#include "Lazy.h"
+#line 20 "Lazy.mpp"
+ void Lazy::Registry::add (int x)
+{ Entries().push_back( x ); }
+#line 26 "Lazy.mpp"
+ int main ()
+{
+Lazy::Registry::add( 1 );
+Lazy::Registry::add( 2 );
+
+return ( Lazy::Registry::Entries().size() == 2
+&& Lazy::Registry::Name() == "Hello, world!" ) ? 0 : 1;}
+
@@ -0,0 +1,18 @@
+#ifndef __MODULE__LAZY_
+#define __MODULE__LAZY_
+#include <string>
+#include <vector>
+namespace Lazy {
+inline const std::string& Greeting ()
+{ static const std::string lazyInstance = "Hello, world"; return lazyInstance; }
+typedef std::vector<int> Numbers;
+class Registry{
+public: static Numbers& Entries ()
+{ static Numbers lazyInstance; return lazyInstance; }
+public: static std::string& Name ()
+{ static std::string lazyInstance = Greeting() + "!"; return lazyInstance; }
+public: static void add (int x);
+}; // class Registry
+} // namespace Lazy
+#endif // module Lazy
+
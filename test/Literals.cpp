@@ -0,0 +1,16 @@
+#include "Literals.h"
+#line 11 "Literals.mpp"
+ const char Literals::Version[]="1.0";
+#line 15 "Literals.mpp"
+ const char Literals::Messages::Welcome[] = "Welcome";
+#line 16 "Literals.mpp"
+ const char Literals::Messages::Farewell[] = "Goodbye, see you soon";
+#line 21 "Literals.mpp"
+ int main ()
+{
+const std::string welcome = Literals::Messages::Welcome;
+
+return ( welcome == "Welcome"
+&& std::strlen( Literals::Messages::Farewell ) == 21
+&& std::string( Literals::Version ) == "1.0" ) ? 0 : 1;}
+
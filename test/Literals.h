@@ -0,0 +1,13 @@
+#ifndef __MODULE__LITERALS_
+#define __MODULE__LITERALS_
+#include <string>
+#include <cstring>
+namespace Literals {
+extern const char Version[];
+class Messages{
+public: static const char Welcome[];
+public: static const char Farewell[];
+}; // class Messages
+} // namespace Literals
+#endif // module Literals
+
@@ -0,0 +1,29 @@
+# Generated by Cp3-- v0.40 20100224
+
+CP3 ?= cp3
+CP3FLAGS ?= 
+CXXFLAGS ?=
+LDFLAGS ?=
+
+.PHONY: all clean
+
+all: Distance
+
+Units.cpp: Units.mpp
+	$(CP3) $(CP3FLAGS) --force $<
+Units.h: Units.cpp ;
+Units.o: Units.cpp Units.h
+	$(CXX) $(CXXFLAGS) -MMD -MP -MF $@.d -c $< -o $@
+
+Distance.cpp: Distance.mpp
+	$(CP3) $(CP3FLAGS) --force $<
+Distance.h: Distance.cpp ;
+Distance.o: Distance.cpp Distance.h Units.h
+	$(CXX) $(CXXFLAGS) -MMD -MP -MF $@.d -c $< -o $@
+Distance: Distance.o Units.o
+	$(CXX) $^ -o $@ $(LDFLAGS)
+
+clean:
+	rm -f Units.h Units.cpp Units.o Distance Distance.h Distance.cpp Distance.o Units.o.d Distance.o.d
+
+-include Units.o.d Distance.o.d
@@ -0,0 +1,30 @@
+#include "Packed.h"
+#line 14 "Packed.mpp"
+ double Packed::Point::getX () const
+{ return x; }
+#line 16 "Packed.mpp"
+ double Packed::Point::getY () const
+{ return y; }
+#line 18 "Packed.mpp"
+ int Packed::Point::getCount () const
+{ return count; }
+#line 20 "Packed.mpp"
+ char Packed::Point::getTag () const
+{ return tag; }
+#line 10 "Packed.mpp"
+ Packed::Point::Point (char t, double x, int n, double y) :x( x ), y( y ), count( n ), tag( t )
+{}
+#line 35 "Packed.mpp"
+ int Packed::Range::getLength () const
+{ return last - first; }
+#line 31 "Packed.mpp"
+ Packed::Range::Range (int f, double s) :first( f ), scale( s ), last( first + 10 )
+{}
+#line 45 "Packed.mpp"
+ int main ()
+{
+Packed::Point p( 'a', 1.0, 2, 3.0 );
+Packed::Range r( 5, 2.0 );
+
+return ( p.getCount() == 2 && p.getTag() == 'a' && r.getLength() == 10 ) ? 0 : 1;}
+
@@ -0,0 +1,24 @@
+#ifndef __MODULE__PACKED_
+#define __MODULE__PACKED_
+namespace Packed {
+class Point{
+public:  double getX () const;
+public:  double getY () const;
+public:  int getCount () const;
+public:  char getTag () const;
+private:  double x;
+private:  double y;
+private:  int count;
+private:  char tag;
+public:  Point (char t, double x, int n, double y);
+}; // class Point
+class Range{
+public:  int getLength () const;
+private:  int first;
+private:  double scale;
+private:  int last;
+public:  Range (int f, double s);
+}; // class Range
+} // namespace Packed
+#endif // module Packed
+
@@ -0,0 +1,11 @@
+#include "Point.h"
+#line 10 "Point.mpp"
+ Geo::Point::Point (double a, double b) :x( a ), y( b )
+{}
+#line 12 "Point.mpp"
+ double Geo::Point::getX () const
+{ return x; }
+#line 14 "Point.mpp"
+ double Geo::Point::getY () const
+{ return y; }
+
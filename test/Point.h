@@ -0,0 +1,13 @@
+#ifndef __MODULE__POINT_
+#define __MODULE__POINT_
+namespace Geo {
+class Point{
+public:  Point (double a, double b);
+public:  double getX () const;
+public:  double getY () const;
+private:  double x;
+private:  double y;
+}; // class Point
+} // namespace Geo
+#endif // module Point
+
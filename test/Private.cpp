@@ -0,0 +1,44 @@
+#include "Private.h"
+namespace Private {
+class Hidden{
+#line 29 "Private.mpp"
+public:  int twice (int x) const;
+}; // class Hidden
+#line 35 "Private.mpp"
+extern const int Limit;
+#line 37 "Private.mpp"
+static int helper (int x);
+} // namespace Private
+#line 11 "Private.mpp"
+ Private::Counter::Counter () :value( 0 )
+{}
+#line 13 "Private.mpp"
+ void Private::Counter::increment ()
+{ ++value; }
+#line 15 "Private.mpp"
+ int Private::Counter::get () const
+{ return value; }
+#line 23 "Private.mpp"
+ int Private::Base::getId () const
+{ return 7; }
+#line 29 "Private.mpp"
+ int Private::Hidden::twice (int x) const
+{ return x * 2; }
+#line 35 "Private.mpp"
+ const int Private::Limit=10;
+#line 37 "Private.mpp"
+static int Private::helper (int x)
+{
+Hidden h;
+return h.twice( x ) + Limit;}
+#line 49 "Private.mpp"
+ int Private::Tally::compute (int x) const
+{ return helper( x ); }
+#line 56 "Private.mpp"
+ int main ()
+{
+Private::Tally t;
+
+t.add();
+return ( t.getScore() == 4 && t.getId() == 7 && t.compute( 1 ) == 12 ) ? 0 : 1;}
+
@@ -0,0 +1,24 @@
+#ifndef __MODULE__PRIVATE_
+#define __MODULE__PRIVATE_
+namespace Private {
+class Counter{
+public:  Counter ();
+public:  void increment ();
+public:  int get () const;
+private:  int value;
+}; // class Counter
+class Base{
+public:  int getId () const;
+}; // class Base
+typedef int Score;
+class Tally:public Base{
+public:  void add ()
+{ counter.increment(); }
+public:  Score getScore () const
+{ return counter.get() + 3; }
+public:  int compute (int x) const;
+private:  Counter counter;
+}; // class Tally
+} // namespace Private
+#endif // module Private
+
@@ -0,0 +1,21 @@
+#include "Route.h"
+#include "Point.h"
+#line 13 "Route.mpp"
+ Geo::Route::Route (const Point &a, const Point &b)
+{ from = a.getX(); to = b.getX(); }
+#line 15 "Route.mpp"
+ bool Geo::Route::startsAt (const Point &p) const
+{ return p.getX() == from; }
+#line 17 "Route.mpp"
+ double Geo::Route::getLength () const
+{ return to - from; }
+#line 26 "Route.mpp"
+ int main ()
+{
+Geo::Point a( 0, 0 );
+Geo::Point b( 3, 0 );
+Geo::Route route( a, b );
+
+return ( route.startsAt( a )
+&& route.getLength() == 3 ) ? 0 : 1;}
+
@@ -0,0 +1,14 @@
+#ifndef __MODULE__ROUTE_
+#define __MODULE__ROUTE_
+namespace Geo { class Point; }
+namespace Geo {
+class Route{
+public:  Route (const Point &a, const Point &b);
+public:  bool startsAt (const Point &p) const;
+public:  double getLength () const;
+private:  double from;
+private:  double to;
+}; // class Route
+} // namespace Geo
+#endif // module Route
+
@@ -0,0 +1,6 @@
+#include "Scopes.h"
+#line 17 "Scopes.mpp"
+ const int Scopes::Computed::Size=compute();
+#line 18 "Scopes.mpp"
+ const int Scopes::Computed::Twice=Size * 2;
+
@@ -0,0 +1,18 @@
+#ifndef __MODULE__SCOPES_
+#define __MODULE__SCOPES_
+namespace Scopes {
+namespace Fixed {
+constexpr const int Size=16;
+constexpr const int Twice=Size * 2;
+} // namespace Fixed
+namespace Computed {
+inline int compute ()
+{
+return 42;}
+extern const int Size;
+extern const int Twice;
+constexpr const int Outer=Fixed::Size + 1;
+} // namespace Computed
+} // namespace Scopes
+#endif // module Scopes
+
@@ -0,0 +1,28 @@
+#include "Shapes.h"
+#line 17 "Shapes.mpp"
+ Shapes::Square::Square (double s) :side( s )
+{}
+#line 19 "Shapes.mpp"
+ double Shapes::Square::getArea () const
+{ return side * side; }
+#line 27 "Shapes.mpp"
+ Shapes::Rectangle::Rectangle (double w, double h) :width( w ), height( h )
+{}
+#line 29 "Shapes.mpp"
+ double Shapes::Rectangle::getArea () const
+{ return width * height; }
+#line 38 "Shapes.mpp"
+ int main ()
+{
+std::vector<Shapes::ShapeVariant> shapes;
+double total = 0;
+
+shapes.push_back( Shapes::Square( 2 ) );
+shapes.push_back( Shapes::Rectangle( 2, 3 ) );
+
+for(unsigned int i = 0; i < shapes.size(); ++i) {
+total += Shapes::ShapeDispatch::getArea( shapes[ i ] );
+}
+
+return ( total == 10 ) ? 0 : 1;}
+
@@ -0,0 +1,37 @@
+#ifndef __MODULE__SHAPES_
+#define __MODULE__SHAPES_
+#include <vector>
+namespace Shapes {
+class Shape{
+public:  virtual double getArea () const = 0;
+}; // class Shape
+class Square:public Shape{
+public:  Square (double s);
+public:  double getArea () const;
+private:  double side;
+}; // class Square
+class Rectangle:public Shape{
+public:  Rectangle (double w, double h);
+public:  double getArea () const;
+private:  double width;
+private:  double height;
+}; // class Rectangle
+} // namespace Shapes
+
+#include <variant>
+#include <type_traits>
+
+namespace Shapes { 
+
+/// The closed hierarchy of Shape, as a value type
+typedef std::variant< ::Shapes::Square, ::Shapes::Rectangle > ShapeVariant;
+
+/// Calls the methods of Shape on a ShapeVariant, with no indirect calls
+struct ShapeDispatch {
+    static double getArea (const ShapeVariant &cp3Variant)
+        { return std::visit( [&]( const auto &cp3Object ) -> double { typedef typename std::decay<decltype( cp3Object )>::type Cp3Type; return cp3Object.Cp3Type::getArea(); }, cp3Variant ); }
+};
+}
+
+#endif // module Shapes
+
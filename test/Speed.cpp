@@ -0,0 +1,11 @@
+#include "Speed.h"
+#include "Units.h"
+#line 11 "Speed.mpp"
+ double Speed::toMetersPerSecond (double milesPerHour)
+{
+return Units::toMeters( milesPerHour ) / 3600;}
+#line 17 "Speed.mpp"
+ int main ()
+{
+return ( Speed::toMetersPerSecond( 60 ) > 26 ) ? 0 : 1;}
+
@@ -0,0 +1,7 @@
+#ifndef __MODULE__SPEED_
+#define __MODULE__SPEED_
+namespace Speed {
+ double toMetersPerSecond (double milesPerHour);
+} // namespace Speed
+#endif // module Speed
+
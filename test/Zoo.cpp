@@ -0,0 +1,31 @@
+#include "Zoo.h"
+#line 12 "Zoo.mpp"
+ std::string Zoo::Animal::getSound () const
+{ return "..."; }
+#line 14 "Zoo.mpp"
+ int Zoo::Animal::getLegs () const
+{ return 4; }
+#line 16 "Zoo.mpp"
+ bool Zoo::Animal::isAlive () const
+{ return true; }
+#line 22 "Zoo.mpp"
+ std::string Zoo::Bird::getSound () const
+{ return "tweet"; }
+#line 24 "Zoo.mpp"
+ int Zoo::Bird::getLegs () const
+{ return 2; }
+#line 30 "Zoo.mpp"
+ std::string Zoo::Dog::getSound () const
+{ return "woof"; }
+#line 36 "Zoo.mpp"
+ int main ()
+{
+Zoo::Dog dog;
+Zoo::Bird bird;
+const Zoo::Animal &animal = dog;
+
+return ( animal.getSound() == "woof"
+&& animal.getLegs() == 4
+&& bird.getLegs() == 2
+&& animal.isAlive() ) ? 0 : 1;}
+
@@ -0,0 +1,19 @@
+#ifndef __MODULE__ZOO_
+#define __MODULE__ZOO_
+#include <string>
+namespace Zoo {
+class Animal{
+public:  virtual std::string getSound () const;
+public:  virtual int getLegs () const;
+public:  virtual bool isAlive () const final;
+}; // class Animal
+class Bird final:public Animal{
+public:  virtual std::string getSound () const;
+public:  virtual int getLegs () const;
+}; // class Bird
+class Dog final:public Animal{
+public:  virtual std::string getSound () const;
+}; // class Dog
+} // namespace Zoo
+#endif // module Zoo
+
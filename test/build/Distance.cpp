@@ -0,0 +1,10 @@
+#include "Distance.h"
+#line 10 "Distance.mpp"
+ double Distance::getMarathon ()
+{
+return Units::toMeters( 26.2 );}
+#line 16 "Distance.mpp"
+ int main ()
+{
+return ( Distance::getMarathon() > 42000 ) ? 0 : 1;}
+
@@ -0,0 +1,8 @@
+#include "Units.h"
+#line 8 "Units.mpp"
+ const double Units::MetersPerMile=1609.344;
+#line 10 "Units.mpp"
+ double Units::toMeters (double miles)
+{
+return miles * MetersPerMile;}
+
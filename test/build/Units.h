@@ -0,0 +1,8 @@
+#ifndef __MODULE__UNITS_
+#define __MODULE__UNITS_
+namespace Units {
+extern const double MetersPerMile;
+ double toMeters (double miles);
+} // namespace Units
+#endif // module Units
+
@@ -19,3 +19,132 @@ g++ Person.cpp Math.cpp
 ./$1 Utils.Containers.Stack.mpp
 g++ testutils.cpp Utils.String.cpp Utils.Math.cpp Utils.Containers.Stack.cpp
 ./a.out
+
+# Constants defined as constexpr, with the same names in several namespaces
+./$1 --constexpr Scopes.mpp
+g++ -std=c++11 -c Scopes.cpp
+
+# Fields packed by alignment, keeping the order initializers rely on
+./$1 --pack-fields Packed.mpp
+g++ -Wreorder -Werror Packed.cpp
+./a.out
+
+# Private declarations in the implementation, save for the ones the header refers to
+./$1 --private-impl Private.mpp
+g++ Private.cpp
+./a.out
+
+# Closed hierarchies, dispatched through a variant
+./$1 Shapes.mpp
+g++ -std=c++17 Shapes.cpp
+./a.out
+
+# Classes and fields aligned to cache lines, with hot and cold sections
+./$1 Cache.mpp
+g++ -std=c++11 Cache.cpp
+./a.out
+
+# Atomic fields which may share a cache line, only warned about at high strictness
+./$1 --level=3 Counters.mpp
+g++ -std=c++11 Counters.cpp
+./a.out
+
+# Dependency files, one per module and all in a single file
+./$1 --force -MD Units.mpp Distance.mpp
+./$1 --force -MF=Modules.d Units.mpp Distance.mpp
+make -s -f Modules.d Distance.h
+g++ Distance.cpp Units.cpp
+./a.out
+
+# Build files for a set of modules, for Ninja and make
+./$1 --emit-ninja=Modules.ninja Units.mpp Distance.mpp
+./$1 --emit-make=Modules.mk Units.mpp Distance.mpp
+make -s -B -f Modules.mk CP3=./$1
+./Distance
+
+# Reading the module from standard input, writing both files to standard output
+./$1 --stdout --module=Distance - < Distance.mpp > DistanceStream.cpp
+g++ DistanceStream.cpp Units.cpp
+./a.out
+
+# Dependencies listed without parsing, so imported modules are generated first
+./$1 --scan-deps=Modules.deps Distance.mpp Units.mpp
+grep -q "^Distance.mpp: Units.h$" Modules.deps
+./$1 --force Units.mpp Distance.mpp
+g++ Distance.cpp Units.cpp
+./a.out
+
+# Generated files written out of the source tree
+./$1 --outdir=build Units.mpp Distance.mpp
+g++ build/Distance.cpp build/Units.cpp
+./a.out
+
+# Imported modules generated along with the ones importing them
+./$1 --force --recursive Distance.mpp
+g++ Distance.cpp Units.cpp
+./a.out
+
+# Index of importers, to regenerate the modules affected by a change in Units
+./$1 --index=Modules.idx Units.mpp Distance.mpp
+./$1 --affected=Modules.idx Units.mpp | grep -q "^Distance.mpp"
+./$1 --force $(./$1 --affected=Modules.idx Units.mpp | cut -f 1 | grep "\.mpp$")
+g++ Distance.cpp Units.cpp
+./a.out
+
+# Dependencies in a single database: appended, recovered from a damaged record, compacted
+./$1 --force --depdb=Modules.depdb Units.mpp Distance.mpp
+./$1 --force --depdb=Modules.depdb Distance.mpp
+printf 'damaged' >> Modules.depdb
+./$1 --force --depdb=Modules.depdb Units.mpp
+./$1 --export-deps=Modules.depdb | grep -q "of 2 module(s)"
+g++ Distance.cpp Units.cpp
+./a.out
+
+# Symbols used from imported modules, so a change in Units makes Distance stale
+./$1 --force --symbols Units.mpp Distance.mpp
+sed 's/double miles/float miles/' Units.mpp | ./$1 --force --symbols --module=Units -
+./$1 --stale Distance.mpp | grep -q "^Distance.mpp$"
+./$1 --force --symbols $(./$1 --stale Distance.mpp | grep "\.mpp$")
+g++ Distance.cpp Units.cpp
+./a.out
+./$1 --force --symbols Units.mpp Distance.mpp
+
+# Imported classes only used by reference in prototypes, forward declared in the header
+./$1 Point.mpp
+./$1 --fwd-decls Route.mpp
+grep -q "class Point;" Route.h
+g++ Route.cpp Point.cpp
+./a.out
+
+# Imported modules only used in function bodies, included in the implementation
+./$1 --move-imports Speed.mpp
+test $(grep -c "Units.h" Speed.h) -eq 0
+g++ Speed.cpp Units.cpp
+./a.out
+
+# Short functions placed in the header, and long inline ones in the implementation
+./$1 --inline-policy Inlining.mpp
+grep -q "inline int twice" Inlining.h
+g++ Inlining.cpp
+./a.out
+
+# String constants initialized with literals, as char arrays
+./$1 --char-arrays Literals.mpp
+g++ Literals.cpp
+./a.out
+
+# Lazy statics, initialized through accessors when first used
+./$1 Lazy.mpp
+g++ Lazy.cpp
+./a.out
+
+# Leaf classes and virtual methods not overridden, sealed
+./$1 --seal Zoo.mpp
+g++ -std=c++11 Zoo.cpp
+./a.out
+
+# Size and alignment of classes checked with static assertions, against their budgets
+./$1 --layout-budget=Budget.layout Budget.mpp
+grep -q "static_assert( sizeof( ::Budget::Header ) <= 16" Budget.cpp
+g++ -std=c++11 Budget.cpp
+./a.out